@@ -0,0 +1,291 @@
+#include "bench.h"
+
+/**
+ * Prepares a benchmark run; nothing is generated until setUp().
+ *
+ * @param options Dataset sizes, iteration count and output format.
+ */
+Bench::Bench(const BenchOptions& options) : options(options), rng(options.seed) {}
+
+/**
+ * Creates the scratch directory (data/exams, data/results, run/), moves into
+ * run/ and writes the exam source file used for uploads.
+ *
+ * @return False if the directory could not be created.
+ */
+bool Bench::setUp() {
+    char dir[] = "/tmp/exam_bench.XXXXXX";
+    if (!mkdtemp(dir)) {
+        cerr << "Error: Unable to create scratch directory" << endl;
+        return false;
+    }
+    root = dir;
+    mkdir((root + "/data").c_str(), 0755);
+    mkdir((root + "/data/exams").c_str(), 0755);
+    mkdir((root + "/data/results").c_str(), 0755);
+    mkdir((root + "/run").c_str(), 0755);
+    if (chdir((root + "/run").c_str()) != 0) {
+        cerr << "Error: Unable to enter " << root << "/run" << endl;
+        return false;
+    }
+
+    // One exam in the instructor upload format
+    sourceFile = "exam_source.txt";
+    ofstream out(sourceFile);
+    uniform_int_distribution<int> option(0, 3);
+    for (int q = 0; q < options.questions; ++q) {
+        out << "Q: Generated question " << q + 1 << ": which option is the right one for this benchmark item?\n";
+        for (char o = 'A'; o <= 'D'; ++o)
+            out << o << ") Option " << o << " of question " << q + 1 << "\n";
+        out << "A: " << char('A' + option(rng)) << "\n";
+    }
+    return true;
+}
+
+/**
+ * Removes the scratch directory unless it was asked to be kept.
+ */
+void Bench::tearDown() {
+    if (root.empty()) return;
+    if (options.keep) {
+        cerr << "[+] data kept in " << root << endl;
+        return;
+    }
+    string command = "rm -rf '" + root + "'";
+    if (system(command.c_str()) != 0) cerr << "Warning: Unable to remove " << root << endl;
+}
+
+bool Bench::selected(const string& name) const {
+    return options.filter.empty() || name.find(options.filter) != string::npos;
+}
+
+/**
+ * Calls body(i) for i in [0, iterations) and records each call's duration.
+ */
+void Bench::measure(const string& name, int iterations, const function<void(int)>& body) {
+    BenchResult result;
+    result.name = name;
+    result.micros.reserve(iterations);
+    for (int i = 0; i < iterations; ++i) {
+        auto t0 = chrono::steady_clock::now();
+        body(i);
+        result.micros.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count());
+    }
+    results.push_back(move(result));
+}
+
+/**
+ * A random answer sheet for the generated exam, in the client's format.
+ */
+string Bench::answerSheet() {
+    uniform_int_distribution<int> option(-1, 3), spent(1, 120);
+    vector<int> answers(options.questions), seconds(options.questions);
+    for (int q = 0; q < options.questions; ++q) {
+        answers[q] = option(rng);
+        seconds[q] = spent(rng);
+    }
+    shared_ptr<const ExamImage> image = ExamImage::get("bench_0");
+    return AnswerSheet::encode(image ? image->paperHash() : "", answers, seconds);
+}
+
+/**
+ * Runs every selected benchmark. Progress messages printed by the code under
+ * test are discarded so they do not mix with the results.
+ */
+void Bench::run() {
+    ofstream devnull("/dev/null");
+    streambuf* saved = cout.rdbuf(devnull.rdbuf());
+
+    benchParseExam();
+    benchLoadExamEntries();
+    benchSendPaper();
+    benchGrade();
+    benchAnalyzeExam();
+    benchAuthenticate();
+    benchDecryptPaper();
+
+    cout.rdbuf(saved);
+}
+
+// Uploads all the generated exams; the later benchmarks use them
+void Bench::benchParseExam() {
+    ExamManager manager;
+    function<void(int)> upload = [&](int i) {
+        manager.parse_exam("q", sourceFile, "bench_" + to_string(i), "instructor", 60, "");
+    };
+
+    if (selected("parse_exam")) {
+        measure("parse_exam", options.exams, upload);
+    } else {
+        for (int i = 0; i < options.exams; ++i) upload(i);
+    }
+}
+
+void Bench::benchLoadExamEntries() {
+    if (!selected("load_exam_entries")) return;
+    ExamManager manager;
+    measure("load_exam_entries", options.iterations, [&](int) {
+        manager.load_exam_entries("../data/exams/exam_list.txt");
+    });
+}
+
+// Writes the pre-encoded PAPER frame from the exam image into a socketpair
+// drained by another thread, with sendfile() as the server does, then the
+// cached compressed frame a deflate-capable client gets
+void Bench::benchSendPaper() {
+    if (!selected("send_paper") && !selected("send_paper_deflate")) return;
+
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+        cerr << "Error: socketpair failed" << endl;
+        return;
+    }
+    pthread_t reader;
+    pthread_create(&reader, nullptr, [](void* arg) -> void* {
+        int fd = *static_cast<int*>(arg);
+        Frame frame;
+        while (Protocol::recvFrame(fd, frame)) {}
+        return nullptr;
+    }, &sv[1]);
+
+    if (selected("send_paper")) measure("send_paper", options.iterations, [&](int) {
+        shared_ptr<const ExamImage> image = ExamImage::get("bench_0");
+        off_t position = image->paperFrameOffset();
+        size_t remaining = image->paperFrameLength();
+        while (remaining > 0) {
+            ssize_t sent = sendfile(sv[0], image->fileDescriptor(), &position, remaining);
+            if (sent <= 0) break;
+            remaining -= sent;
+        }
+    });
+
+    // The first call compresses the paper; the timed calls hit the cache
+    if (selected("send_paper_deflate") && PaperCache::deflated("bench_0")) {
+        measure("send_paper_deflate", options.iterations, [&](int) {
+            shared_ptr<const string> frame = PaperCache::deflated("bench_0");
+            send(sv[0], frame->data(), frame->size(), MSG_NOSIGNAL);
+        });
+    }
+
+    close(sv[0]);
+    pthread_join(reader, nullptr);
+    close(sv[1]);
+}
+
+void Bench::benchGrade() {
+    if (!selected("grade_answers")) return;
+
+    vector<string> sheets;
+    for (int i = 0; i < 64; ++i) sheets.push_back(answerSheet());
+
+    measure("grade_answers", options.iterations, [&](int i) {
+        Submission submission;
+        string error;
+        Server::gradeAnswerSheet("student", "bench_0", sheets[i % sheets.size()], submission, error);
+    });
+}
+
+// Builds the instructor and student analysis reports of an exam with options.students attempts
+void Bench::benchAnalyzeExam() {
+    if (!selected("analyze_exam")) return;
+
+    shared_ptr<ExamStats> stats = ExamStats::forExam("bench_1", options.questions);
+    shared_ptr<Leaderboard> board = Leaderboard::forExam("bench_1");
+    for (int s = 0; s < options.students; ++s) {
+        Submission submission;
+        string error;
+        if (!Server::gradeAnswerSheet("s" + to_string(s), "bench_1", answerSheet(), submission, error)) continue;
+        stats->record(submission, s + 1);
+        board->add(submission, s + 1);
+    }
+
+    // Replies are kept on the session instead of going to a reactor
+    Session session(0, -1, nullptr);
+    session.busy = true;
+    session.username = "s0";
+
+    measure("analyze_exam_instructor", options.iterations, [&](int) {
+        Server::analyzeExam("bench_1", session, false);
+        session.deferred.clear();
+    });
+    measure("analyze_exam_student", options.iterations, [&](int) {
+        Server::analyzeExam("bench_1", session, true);
+        session.deferred.clear();
+    });
+}
+
+void Bench::benchAuthenticate() {
+    if (!selected("authenticate_user")) return;
+
+    // Every register and login runs the password KDF (tens of milliseconds),
+    // so a few accounts and iterations are enough to measure it
+    AuthManager auth;
+    int accounts = min(options.students, 32);
+    for (int s = 0; s < accounts; ++s)
+        AuthManager::register_user("u" + to_string(s), "pw" + to_string(s), "student");
+
+    uniform_int_distribution<int> pick(0, accounts - 1);
+    measure("authenticate_user", min(options.iterations, 50), [&](int) {
+        int s = pick(rng);
+        AuthManager::authenticate_user("u" + to_string(s), "pw" + to_string(s), "student");
+    });
+}
+
+// The client's decrypt + parse + shuffle of a downloaded paper
+void Bench::benchDecryptPaper() {
+    if (!selected("decrypt_prepare_exam")) return;
+
+    ExamManager manager;
+    string paper;
+    manager.getExamQuestions("bench_0", paper);
+    for (char& ch : paper) ch ^= 'X';
+    string path = "bench_0_questions.txt";
+    ofstream(path, ios::binary) << paper;
+
+    measure("decrypt_prepare_exam", options.iterations, [&](int) {
+        Client::decryptAndPrepareExam(path, 'X');
+    });
+}
+
+/**
+ * Prints one row per benchmark: dataset sizes, iterations and latency
+ * statistics in microseconds, as JSON or CSV.
+ *
+ * @param out Stream to print to.
+ */
+void Bench::print(ostream& out) const {
+    auto stat = [](vector<double> v, double p) {
+        if (v.empty()) return 0.0;
+        sort(v.begin(), v.end());
+        size_t rank = (size_t)ceil(p * v.size());
+        return v[max(rank, (size_t)1) - 1];
+    };
+
+    out << fixed << setprecision(2);
+    if (options.format == "csv") {
+        out << "name,questions,students,exams,iterations,mean_us,p50_us,p95_us,p99_us,min_us,max_us\n";
+    } else {
+        out << "{\n  \"questions\": " << options.questions << ", \"students\": " << options.students
+            << ", \"exams\": " << options.exams << ",\n  \"results\": [\n";
+    }
+
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        double mean = r.micros.empty() ? 0.0 : accumulate(r.micros.begin(), r.micros.end(), 0.0) / r.micros.size();
+        double minimum = r.micros.empty() ? 0.0 : *min_element(r.micros.begin(), r.micros.end());
+
+        if (options.format == "csv") {
+            out << r.name << "," << options.questions << "," << options.students << "," << options.exams << ","
+                << r.micros.size() << "," << mean << "," << stat(r.micros, 0.50) << "," << stat(r.micros, 0.95) << ","
+                << stat(r.micros, 0.99) << "," << minimum << "," << stat(r.micros, 1.0) << "\n";
+        } else {
+            out << "    {\"name\": \"" << r.name << "\", \"iterations\": " << r.micros.size()
+                << ", \"mean_us\": " << mean << ", \"p50_us\": " << stat(r.micros, 0.50)
+                << ", \"p95_us\": " << stat(r.micros, 0.95) << ", \"p99_us\": " << stat(r.micros, 0.99)
+                << ", \"min_us\": " << minimum << ", \"max_us\": " << stat(r.micros, 1.0) << "}"
+                << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+    }
+
+    if (options.format != "csv") out << "  ]\n}\n";
+}
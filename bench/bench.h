@@ -0,0 +1,80 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <iomanip>
+#include <cmath>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+
+#include "server.h"
+#include "client.h"
+#include "exam_stats.h"
+#include "leaderboard.h"
+#include "protocol.h"
+#include "paper_cache.h"
+
+using namespace std;
+
+// Dataset sizes and output settings
+struct BenchOptions {
+    int questions = 50;         // questions per generated exam
+    int students = 1000;        // accounts and submissions per exam
+    int exams = 100;            // exams uploaded (and listed in exam_list.txt)
+    int iterations = 200;       // timed calls per benchmark
+    string format = "json";     // json | csv
+    string filter;              // run only benchmarks whose name contains this
+    bool keep = false;          // leave the generated data directory behind
+    unsigned seed = 1;
+};
+
+// Timings of one benchmark
+struct BenchResult {
+    string name;
+    vector<double> micros;
+};
+
+// Times the server's and client's hot functions on generated data. Runs in a
+// scratch directory laid out like the repository (run/ next to data/), so the
+// code under test uses its usual relative ../data paths.
+class Bench {
+public:
+    explicit Bench(const BenchOptions& options);
+
+    bool setUp();
+    void run();
+    void print(ostream& out) const;
+    void tearDown();
+
+private:
+    BenchOptions options;
+    string root;
+    string sourceFile;          // generated exam in upload format
+    vector<BenchResult> results;
+    mt19937 rng;
+
+    bool selected(const string& name) const;
+    void measure(const string& name, int iterations, const function<void(int)>& body);
+    string answerSheet();
+
+    void benchParseExam();
+    void benchLoadExamEntries();
+    void benchSendPaper();
+    void benchGrade();
+    void benchAnalyzeExam();
+    void benchAuthenticate();
+    void benchDecryptPaper();
+};
+
+#endif
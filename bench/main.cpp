@@ -0,0 +1,39 @@
+#include "bench.h"
+
+static void usage(const char* program) {
+    cerr << "Usage: " << program << " [-q questions] [-s students] [-e exams] [-i iterations]\n"
+         << "       [-f json|csv] [-b name filter] [-k keep data] [-r seed]\n";
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "q:s:e:i:f:b:kr:h")) != -1) {
+        switch (opt) {
+            case 'q': options.questions = atoi(optarg); break;
+            case 's': options.students = atoi(optarg); break;
+            case 'e': options.exams = atoi(optarg); break;
+            case 'i': options.iterations = atoi(optarg); break;
+            case 'f': options.format = optarg; break;
+            case 'b': options.filter = optarg; break;
+            case 'k': options.keep = true; break;
+            case 'r': options.seed = strtoul(optarg, nullptr, 10); break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+
+    // Two exams are always needed: one to read and grade, one to analyze
+    if (options.questions <= 0 || options.students <= 0 || options.exams < 2 || options.iterations <= 0 ||
+        (options.format != "json" && options.format != "csv")) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    Bench bench(options);
+    if (!bench.setUp()) return 1;
+    bench.run();
+    bench.print(cout);
+    bench.tearDown();
+    return 0;
+}
@@ -1,7 +1,10 @@
 #include "client.h"
 #include "ui.h"
 
+#define AUTOSAVE_SECONDS 10
+
 map<int, int> Client::timeSpentPerQuestion;
+string Client::preparedPaperHash;
 map<int, int> Client::shuffledQuestionMap;
 vector<vector<int>> Client::shuffledOptionMap;
 vector<string> Client::shuffledQuestions;
@@ -14,7 +17,7 @@ auto lastTime = steady_clock::now();
 bool Client::timeUp = false;
 pthread_mutex_t Client::timerMutex = PTHREAD_MUTEX_INITIALIZER;
 
-Client::Client(const string& server_ip, int server_port) {
+Client::Client(const string& server_ip, int server_port) : resumedSeconds(0) {
     // Create a TCP socket
     sock = socket(AF_INET, SOCK_STREAM, 0);
     if (sock == -1) {
@@ -56,6 +59,28 @@ int Client::userInput(const string& prompt, int minVal, int maxVal) {
     }
 }
 
+/**
+ * Sends a request that the server answers, and waits for the answer.
+ * If the server is overloaded it replies BUSY with a retry delay; the same
+ * request is then sent again after that delay.
+ *
+ * @param sock Connected socket.
+ * @param type Message type of the request.
+ * @param payload Request body.
+ * @param reply Receives the server's answer.
+ * @return False if the connection failed.
+ */
+bool Client::request(int sock, MsgType type, const string& payload, Frame& reply) {
+    while (true) {
+        if (!Protocol::sendFrame(sock, type, payload)) return false;
+        if (!Protocol::recvFrame(sock, reply)) return false;
+        if (reply.type != MsgType::BUSY) return true;
+
+        int retryMs = atoi(reply.payload.c_str());
+        usleep((retryMs > 0 ? retryMs : 200) * 1000);
+    }
+}
+
 void Client::xorEncryptDecrypt(const string& filePath, char key) {
     fstream file(filePath, ios::in | ios::out | ios::binary);
     if (!file) {
@@ -91,6 +116,7 @@ void Client::decryptAndPrepareExam(const string& filePath, char key) {
     for (char &ch : encryptedContent) {
         ch ^= key;
     }
+    preparedPaperHash = ContentHash::of(encryptedContent);
 
     vector<string> questions;
     vector<vector<string>> options;
@@ -248,7 +274,7 @@ void Client::backupExamData(string &examName, const string &finalData) {
     ensureDirectoryExists(hiddenDir);
 
     string filePath = hiddenDir + "/" + examName + ".txt";
-    ofstream backupFile(filePath);
+    ofstream backupFile(filePath, ios::binary);
     if (backupFile.is_open()) {
         backupFile << finalData;
         backupFile.close();
@@ -258,11 +284,43 @@ void Client::backupExamData(string &examName, const string &finalData) {
     }
 }
 
-void Client::manageExam(int durationMinutes, Client* client, string examName) {
-    int durationSeconds = durationMinutes * 60;
+/**
+ * Builds the batch of answers and times that changed since the last autosave.
+ *
+ * @param answers Current answers, in the shuffled order shown.
+ * @param seconds Current time spent, same order.
+ * @param sentAnswers Answers the server has, in paper order; updated.
+ * @param sentSeconds Times the server has, in paper order; updated.
+ * @return Encoded batch, empty if nothing changed.
+ */
+string Client::collectChanges(const vector<int>& answers, const vector<int>& seconds,
+                              vector<int8_t>& sentAnswers, vector<uint32_t>& sentSeconds) {
+    string batch;
+    for (size_t i = 0; i < answers.size(); ++i) {
+        int q = shuffledQuestionMap[i];
+        if (sentAnswers[q] == answers[i] && sentSeconds[q] == (uint32_t)seconds[i]) continue;
+        sentAnswers[q] = answers[i];
+        sentSeconds[q] = seconds[i];
+        AnswerSheet::addChange(batch, q, answers[i], seconds[i]);
+    }
+    return batch;
+}
+
+void Client::manageExam(int durationSeconds, Client* client, string examName, const string& savedChanges) {
     vector<int> studentAnswers(shuffledQuestions.size(), -1);
     vector<int> timeSpent(shuffledQuestions.size(), 0);
 
+    // What the server has autosaved, in paper order; a resumed exam starts from it
+    vector<int8_t> sentAnswers(shuffledQuestions.size(), -1);
+    vector<uint32_t> sentSeconds(shuffledQuestions.size(), 0);
+    if (!savedChanges.empty())
+        AnswerSheet::applyChanges(savedChanges, sentAnswers.size(), sentAnswers.data(), sentSeconds.data());
+    for (size_t i = 0; i < studentAnswers.size(); ++i) {
+        studentAnswers[i] = sentAnswers[shuffledQuestionMap[i]];
+        timeSpent[i] = sentSeconds[shuffledQuestionMap[i]];
+    }
+    auto lastAutosave = chrono::steady_clock::now();
+
     Client::timeSpentPerQuestion.clear();
 
     int currentIndex = 0;
@@ -397,6 +455,14 @@ void Client::manageExam(int durationMinutes, Client* client, string examName) {
         timeSpent[newCurrentIndex] += chrono::duration_cast<chrono::seconds>(now - questionStartTime).count();
         questionStartTime = chrono::steady_clock::now();
 
+        // Autosave: answer edits go out at once, time spent every AUTOSAVE_SECONDS.
+        // The server does not reply, so this never holds up the exam.
+        if (!timeUp && (opt == 3 || opt == 4 || now - lastAutosave >= chrono::seconds(AUTOSAVE_SECONDS))) {
+            string batch = collectChanges(studentAnswers, timeSpent, sentAnswers, sentSeconds);
+            if (!batch.empty()) Protocol::sendFrame(client->sock, MsgType::ANSWERS_DELTA, batch);
+            lastAutosave = now;
+        }
+
         pthread_mutex_lock(&timerMutex);
         if (timeUp) {
             pthread_mutex_unlock(&timerMutex);
@@ -409,85 +475,94 @@ void Client::manageExam(int durationMinutes, Client* client, string examName) {
     pthread_join(timerThread, nullptr);
     timeUp = false;
 
-    // Prepare answers and time spent to send to server
-    ostringstream dataToSend;
-    dataToSend << "ANSWERS\n";
+    // The rest was autosaved: submitting only sends what changed since
+    string finalChanges = collectChanges(studentAnswers, timeSpent, sentAnswers, sentSeconds);
+    if (finalChanges.empty()) finalChanges = string(1, (char)AnswerSheet::CHANGES);
+
+    // A local copy is the whole sheet, in paper order
+    vector<int> paperAnswers(studentAnswers.size(), -1), paperSeconds(studentAnswers.size(), 0);
     for (int i = 0; i < studentAnswers.size(); ++i) {
         int originalIndex = shuffledQuestionMap[i];
-        dataToSend << originalIndex << "," << studentAnswers[i] << "," << timeSpent[i] << "\n";
+        paperAnswers[originalIndex] = studentAnswers[i];
+        paperSeconds[originalIndex] = timeSpent[i];
     }
-    
-    string finalData =  dataToSend.str();
-    send(client->sock, finalData.c_str(), finalData.size(), 0);
 
-    char mesg[32]={0};
-    int bytesReceived = recv(client->sock, mesg, sizeof(mesg), 0);
-    if (bytesReceived <= 0) {
+    string finalData = AnswerSheet::encode(preparedPaperHash, paperAnswers, paperSeconds);
+
+    // The server acks once the answers are saved; keep a local copy otherwise
+    Frame ack;
+    if (!request(client->sock, MsgType::ANSWERS, finalChanges, ack)) {
         cerr << "[!] Failed to send data to server. Error or connection closed.\n";
         finalData = examName + "\n" + finalData;
         backupExamData(examName,finalData);
+    } else if (ack.type == MsgType::ERROR) {
+        cerr << "[!] " << ack.payload << endl;
+    } else if (ack.payload != "y") {
+        cerr << "[!] Server could not save the answers, they will be sent again at next login.\n";
+        finalData = examName + "\n" + finalData;
+        backupExamData(examName,finalData);
     }
 }
 
 void Client::dashboard(Client * client) {
     int sockfd = client->sock;
-    char buffer[1028];
 
-    while (true) {
-        memset(buffer, 0, sizeof(buffer));
-        recv(sockfd, buffer, sizeof(buffer), 0);
+    // Opening the dashboard makes the server load the attempt history
+    Frame reply;
+    if (!request(sockfd, MsgType::TEXT, "2", reply)) return;
+    string screen = reply.payload;
 
+    while (true) {
         system("clear");
         usleep(200000);
-        cout << buffer;
+        cout << screen;
 
-        string str(buffer);
-        if(str=="[!] No exam data found for student.") break;
+        if(screen=="[!] No exam data found for student.") break;
 
         // User selects an exam (or 0 to go back)
         int input = userInput("",0,100);
         string examSelection = to_string(input);
-        send(sockfd, examSelection.c_str(), examSelection.size(), 0);
+        Protocol::sendText(sockfd, examSelection);
 
         if (input == 0) break;
-    
-        memset(buffer, 0, sizeof(buffer));
+
         // Receive exam attempt info or error message
-        recv(sockfd, buffer, sizeof(buffer), 0);
-        cout << buffer;
-        string mesg(buffer);
+        string mesg;
+        if (!Protocol::recvText(sockfd, mesg)) return;
+        cout << mesg;
         if(mesg=="[!] Invalid option! please select a valid exam."){
             cout << endl;
+            // The server follows up with the dashboard again
+            if (!Protocol::recvText(sockfd, screen)) return;
             continue;
         }
 
         // User selects an attempt number (or 0 to go back)
         input = userInput("", 0, 100);
         examSelection = to_string(input);
-        send(sockfd, examSelection.c_str(), examSelection.size(), 0);
+        if (!request(sockfd, MsgType::TEXT, examSelection, reply)) return;
 
-        if (input == 0) continue;
+        if (input == 0) {
+            screen = reply.payload;
+            continue;
+        }
 
-        memset(buffer, 0, sizeof(buffer));
-        recv(sockfd, buffer, sizeof(buffer), 0);
         system("clear");
-        cout << buffer << endl;
+        cout << reply.payload << endl;
 
-        string mesg1(buffer);
-        if(mesg1=="[!] Invalid option! please select a valid attempt."){
+        string mesg1 = reply.payload;
+        if(mesg1=="[!] Invalid option! please select a valid attempt." || mesg1.rfind("Error:", 0) == 0){
             cout << endl;
+            if (!Protocol::recvText(sockfd, screen)) return;
             continue;
         }
         if(mesg1 == "Exam is still going on."){
             return;
         }
-        sleep(2);
 
-        // Receive exam questions
-        char questionBuffer[5120];
-        recv(sockfd, questionBuffer, sizeof(questionBuffer), 0);
-
-        string receivedData(questionBuffer);
+        // Receive exam questions (sent right after the attempt details)
+        string receivedData;
+        if (!Protocol::recvText(sockfd, receivedData)) return;
 
         stringstream ss(receivedData);
         string examName;
@@ -503,7 +578,6 @@ void Client::dashboard(Client * client) {
             chmod(filename.c_str(), S_IRUSR | S_IRGRP | S_IROTH);
         }
         cout << "\n[+] Exam questions saved to : " << filename << endl;
-        memset(questionBuffer, 0, sizeof(questionBuffer));
 
         string options = "\n--------------------------------------------\n";
         options += "[1] View Exam Analysis\n";
@@ -514,18 +588,20 @@ void Client::dashboard(Client * client) {
 
         input = userInput("",0,1);
         examSelection = to_string(input);
-        send(sockfd, examSelection.c_str(), examSelection.size(), 0);
 
-        if (input == 0) continue;
+        if (input == 0) {
+            Protocol::sendText(sockfd, examSelection);
+            if (!Protocol::recvText(sockfd, screen)) return;
+            continue;
+        }
 
         // Receive and display exam analysis parts
-        memset(questionBuffer, 0, sizeof(questionBuffer));
-        recv(sockfd, questionBuffer, sizeof(questionBuffer), 0);
-        cout << questionBuffer <<endl;
+        if (!request(sockfd, MsgType::TEXT, examSelection, reply)) return;
+        cout << reply.payload << endl;
 
-        memset(questionBuffer, 0, sizeof(questionBuffer));
-        recv(sockfd, questionBuffer, sizeof(questionBuffer), 0);
-        cout << questionBuffer << endl;
+        string leaderboard;
+        if (!Protocol::recvText(sockfd, leaderboard)) return;
+        cout << leaderboard << endl;
         
         cout <<"\npress any key...\n";
         cin.get();
@@ -548,6 +624,7 @@ void Client::parseAvailableExams(const string& examData) {
         size_t pos4 = line.find("| Duration (minutes):");
         size_t pos5 = line.find("| Total Questions:");
         size_t pos6 = line.find("| Instructor:");
+        size_t pos7 = line.find("| Paper:");
 
         if (pos1 != string::npos && pos2 != string::npos && pos3 != string::npos && pos4 != string::npos && pos5 != string::npos && pos6 != string::npos) {
             string name       = line.substr(pos1 + 10, pos2 - (pos1 + 10));
@@ -555,24 +632,25 @@ void Client::parseAvailableExams(const string& examData) {
             string startTime  = line.substr(pos3 + 13, pos4 - (pos3 + 13));
             int duration      = stoi(line.substr(pos4 + 22, pos5 - (pos4 + 22)));
             int totalQ        = stoi(line.substr(pos5 + 19, pos6 - (pos5 + 19)));
-            string instructor = line.substr(pos6 + 13);
-            availableExams.emplace_back(name, type, startTime, duration, totalQ, instructor);        }
+            string instructor = line.substr(pos6 + 13, pos7 == string::npos ? string::npos : pos7 - (pos6 + 13));
+            string paperHash;
+            if (pos7 != string::npos) {
+                istringstream hashField(line.substr(pos7 + 8));
+                hashField >> paperHash;
+            }
+            availableExams.emplace_back(name, type, startTime, duration, totalQ, instructor, paperHash);        }
     }
 }
 
 void Client::handleExamSelection(Client* client, int& choice) {
-    char buffer[4096];
-    memset(buffer, 0, sizeof(buffer));
     // Receive list of available exams from server
-    int bytes_read = recv(client->sock, buffer, sizeof(buffer), 0);
-    if (bytes_read <= 0) {
+    string examData;
+    if (!Protocol::recvText(client->sock, examData)) {
         cerr << "[✖] Error: Failed to read data from server\n";
         close(client->sock);
         return;
     }
 
-    string examData(buffer);
-
     if (examData == "No exams available.") {
         cout << "\n[!] No exams available at the moment.\n\n";
         return;
@@ -599,29 +677,29 @@ void Client::handleExamSelection(Client* client, int& choice) {
 
     if (choice == 0) {
         // Send cancellation to server and return to menu
-        string examSelection = to_string(choice);
-        send(client->sock, examSelection.c_str(), examSelection.size(), 0);
+        Protocol::sendText(client->sock, to_string(choice));
         return;
     }
 
-    // Prepare local storage path for exam paper
+    // Papers are stored under their content hash, so a reordered exam list can
+    // never map to another exam's paper
     const char* home = getenv("HOME");
     string hiddenDir = string(home) + "/.config/.exam";
-    string filePath = hiddenDir + "/" + to_string(choice) + ".txt";
     const ExamInfo& selectedExam = availableExams[choice - 1];
+    string filePath = hiddenDir + "/" + selectedExam.paperHash + ".txt";
+    string sealedPath = hiddenDir + "/" + selectedExam.paperHash + ".sealed";
     ensureDirectoryExists(hiddenDir);
 
-    // Check if exam paper already downloaded locally
-    struct stat stats;
-    bool fileExist = stat(filePath.c_str(), &stats) == 0;
+    // Ask for the paper unless the local copy is current; a valid copy costs no paper bytes
+    bool cached = cachedPaperValid(filePath, selectedExam.paperHash);
+    if (!cached && !fs::exists(sealedPath)) cout << "[!] Downloading exam paper...\n";
+    if (!receiveAndStoreExamQuestions(client->sock, choice, selectedExam.paperHash, filePath, sealedPath, cached)) return;
 
-    if (!fileExist) {
-        cout << "[!] Downloading exam paper...\n";
-        receiveAndStoreExamQuestions(client->sock, choice);
-    } else {
-        // Notify server that local exam copy will be used (negative exam number)
-        int examnumber = -choice;
-        send(client->sock, to_string(examnumber).c_str(), to_string(examnumber).size(), 0);
+    // A scheduled paper fetched ahead of its start stays sealed until the start
+    if (!fs::exists(filePath)) {
+        cout << "[+] Exam paper downloaded in advance; it unlocks at " << selectedExam.start_time << "\n";
+        Protocol::sendText(client->sock, "n");
+        return;
     }
 
     decryptAndPrepareExam(filePath, 'X');
@@ -681,41 +759,32 @@ void Client::handleExamSelection(Client* client, int& choice) {
                 }
                
                 // Notify server that exam will not be started
-                char ch = 'n';
-                send(client->sock, &ch, 1, 0);
+                Protocol::sendText(client->sock, "n");
             }
             else{
                 // Proceed to start the exam
-                send(client->sock, &confirm, 1, 0);
-                sleep(2);
-
-                // Indicate scheduled exam type to server
-                char type = 's';
-                send(client->sock, &type, 1, 0);
-
-                // Check if exam already attempted
-                char retMeg[32]={0};
-                recv(client->sock, retMeg, sizeof(retMeg), 0);
-                string attempted(retMeg);
-                if(attempted=="y"){
+                Protocol::sendText(client->sock, string(1, confirm));
+
+                // Indicate scheduled exam type to server and check if exam already attempted
+                Frame attempted;
+                if (!request(client->sock, MsgType::TEXT, "s", attempted)) return;
+                if(attempted.payload=="y"){
                     cout << "[✖] You have already attempted this exam. Reattempt is not allowed.\n";
                 }
                 else{
-                    manageExam(selectedExam.duration, client,selectedExam.name.c_str());
+                    manageExam(selectedExam.duration * 60, client,selectedExam.name.c_str());
                 }
             }
         }
         else{
             // For practice tests without specific schedule
-            send(client->sock, &confirm, 1, 0);
-            sleep(2);
-            char type = 'm';
-            send(client->sock, &type, 1, 0);
-            manageExam(selectedExam.duration, client, selectedExam.name.c_str());
+            Protocol::sendText(client->sock, string(1, confirm));
+            Protocol::sendText(client->sock, "m");
+            manageExam(selectedExam.duration * 60, client, selectedExam.name.c_str());
         }
     } else {
         // User declined to start exam; notify server and return to menu
-        send(client->sock, &confirm, 1, 0);
+        Protocol::sendText(client->sock, string(1, confirm));
         cout << "Returning to student menu.\n";
     }
 }
@@ -736,40 +805,33 @@ void Client::sendPendingAnswerSheet(int clientSocket){
 
     // If no pending answer sheet is found, notify server and return
     if (foundFile.empty()) {
-        char message = 'n';
-        send(clientSocket, &message, 1, 0);
+        Protocol::sendText(clientSocket, "n");
         return;
     }
 
-    ifstream inFile(foundFile);
+    ifstream inFile(foundFile, ios::binary);
     if (!inFile.is_open()) {
         cerr << "[!] Failed to open: " << foundFile << endl;
-        char message = 'n';
-        send(clientSocket, &message, 1, 0);
+        Protocol::sendText(clientSocket, "n");
         return;
     }
 
+    // Exam name on the first line, then the answer sheet as it was submitted
     string examName;
     getline(inFile, examName);
-
-    string answers, line;
-    while (getline(inFile, line)) {
-        answers += line + "\n";
-    }
+    string answers((istreambuf_iterator<char>(inFile)), istreambuf_iterator<char>());
     inFile.close();
 
     // Send exam name and answers to the server
-    send(clientSocket, examName.c_str(), examName.size(), 0);
-    sleep(1);
-    send(clientSocket, answers.c_str(), answers.size(), 0);
-    sleep(1);
-  
-    char mesg[32]={0};
-    int byte_recv = recv(clientSocket, mesg, sizeof(mesg), 0);
-    if(byte_recv<=0){
+    Frame ack;
+    if(!Protocol::sendText(clientSocket, examName) || !request(clientSocket, MsgType::ANSWERS, answers, ack)){
         cout << "[!] Failed to send the answer sheet\n";
         return;
     }
+    if (ack.type == MsgType::ACK && ack.payload != "y") {
+        cout << "[!] Server could not save the answer sheet, keeping it for next login\n";
+        return;
+    }
 
     // Delete the local answer sheet file after successful submission
     try {
@@ -779,23 +841,68 @@ void Client::sendPendingAnswerSheet(int clientSocket){
     }
 }
 
+/**
+ * Continues the exam a resumed session was in. The server sends the paper
+ * again right after accepting the token; it is stored and prepared like a
+ * downloaded one and the exam runs for the time the server says is left,
+ * starting from the answers autosaved before the drop.
+ */
+void Client::continueExam(Client* client) {
+    Frame paper;
+    if (!Protocol::recvFrame(client->sock, paper) || !decodePaper(paper) || paper.type != MsgType::PAPER) {
+        cerr << "Error: Failed to receive exam questions from server.\n";
+        return;
+    }
+
+    const char* home = getenv("HOME");
+    string hiddenDir = string(home) + "/.config/.exam";
+    string filePath = hiddenDir + "/resume.txt";
+    ensureDirectoryExists(hiddenDir);
+
+    ofstream outFile(filePath);
+    if (!outFile) {
+        cerr << "Error: Unable to create file " << filePath << "\n";
+        return;
+    }
+    outFile << paper.payload;
+    outFile.close();
+
+    xorEncryptDecrypt(filePath, 'X');
+    decryptAndPrepareExam(filePath, 'X');
+
+    // Then the answers autosaved before the connection dropped
+    Frame saved;
+    if (!Protocol::recvFrame(client->sock, saved) || saved.type != MsgType::ANSWERS_DELTA) {
+        cerr << "Error: Failed to receive saved answers from server.\n";
+        return;
+    }
+
+    cout << "[+] Resuming exam " << client->resumedExam << " (" << client->resumedSeconds / 60 << " min "
+         << client->resumedSeconds % 60 << " s left)\n";
+    usleep(1200000);
+    manageExam(client->resumedSeconds, client, client->resumedExam, saved.payload);
+    client->resumedExam.clear();
+}
+
 void* Client::studentHandler(void* arg) {
     Client* client = static_cast<Client*>(arg);
-    char buffer[1024] = {0};
     int choice;
 
-    // Automatically send any saved answer sheet before proceeding
-    sendPendingAnswerSheet(client->sock);
+    // Finish an exam interrupted by a dropped connection, otherwise send any
+    // saved answer sheet before proceeding
+    if (!client->resumedExam.empty()) continueExam(client);
+    else sendPendingAnswerSheet(client->sock);
 
     while (true) {
         UI_elements::displayStudentMenu();
         choice = userInput("",1,3);
 
-        sprintf(buffer, "%d", choice);
-        send(client->sock, buffer, strlen(buffer), 0);
+        // The dashboard sends its own request so it can be retried if the server is busy
+        if (choice != 2) Protocol::sendText(client->sock, to_string(choice));
 
         if (choice == 3) {
             cout << "Logging out...\n";
+            forgetSession();
             close(client->sock);
             return nullptr;
         } else if(choice==1){
@@ -811,61 +918,152 @@ void* Client::studentHandler(void* arg) {
     return nullptr;
 }
 
-void Client::receiveAndStoreExamQuestions(int sock, int examNumber) {
-    char buffer[4096] = {0};
+/**
+ * Turns a compressed paper (PAPER_DEFLATE) back into a plain PAPER frame.
+ *
+ * @param paper Frame received from the server; inflated in place.
+ * @return False if the compressed payload is corrupt.
+ */
+bool Client::decodePaper(Frame& paper) {
+    if (paper.type != MsgType::PAPER_DEFLATE) return true;
+
+    string plain;
+    if (!Compression::inflate(paper.payload, plain)) {
+        cerr << "Error: Received a corrupt exam paper.\n";
+        return false;
+    }
+    paper.type = MsgType::PAPER;
+    paper.payload = move(plain);
+    return true;
+}
 
-    string examSelection = to_string(examNumber);
-    send(sock, examSelection.c_str(), examSelection.size(), 0);
+/**
+ * True if a cached paper exists and still hashes to the expected value.
+ *
+ * @param filePath Encrypted local copy.
+ * @param paperHash Hash announced in the exam list.
+ */
+bool Client::cachedPaperValid(const string& filePath, const string& paperHash) {
+    if (paperHash.empty()) return false;
+
+    ifstream in(filePath, ios::binary);
+    if (!in) return false;
+    string content((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    for (char& ch : content) ch ^= 'X';
+    return ContentHash::of(content) == paperHash;
+}
 
-    sleep(1);
-    // Receive exam questions from the server
-    int bytesReceived = recv(sock, buffer, sizeof(buffer) - 1, 0);
-    if (bytesReceived <= 0) {
+/**
+ * Opens a paper that was handed out sealed before its exam started.
+ *
+ * @param sealedPath Sealed copy stored ahead of the start.
+ * @param paper PAPER_KEY frame; on success it holds the compressed paper.
+ * @return False if the copy is missing or does not open with the key.
+ */
+bool Client::unsealPaper(const string& sealedPath, Frame& paper) {
+    ifstream in(sealedPath, ios::binary);
+    if (!in) return false;
+    string sealed((istreambuf_iterator<char>(in)), istreambuf_iterator<char>()), compressed;
+    if (!Seal::open(paper.payload, sealed, compressed)) return false;
+
+    paper.type = MsgType::PAPER_DEFLATE;
+    paper.payload = move(compressed);
+    return true;
+}
+
+/**
+ * Requests an exam's paper and stores it encrypted at filePath. With a
+ * current cached copy the request is conditional and the server answers
+ * "not modified" (ACK) without sending the paper. Before a scheduled exam
+ * starts the server may hand out the paper sealed instead; it is kept at
+ * sealedPath and only the key is fetched once the exam starts.
+ *
+ * @param sock Connected socket.
+ * @param examNumber Exam position in the list.
+ * @param paperHash Hash announced in the exam list.
+ * @param filePath Where the paper is (or will be) stored.
+ * @param sealedPath Where a sealed copy is (or will be) stored.
+ * @param cached Whether filePath holds a copy matching paperHash.
+ * @return False if the paper could not be obtained; the exam is not started.
+ *         True with no file at filePath if only the sealed copy was stored.
+ */
+bool Client::receiveAndStoreExamQuestions(int sock, int examNumber, const string& paperHash,
+                                          const string& filePath, const string& sealedPath, bool cached) {
+    // Request the exam, advertising the encodings we can decode and the copy we hold
+    string query = to_string(examNumber) + " " + Compression::DEFLATE + " sealed";
+    if (cached) query += " if-none-match=" + paperHash;
+    else if (!paperHash.empty() && fs::exists(sealedPath)) query += " have-sealed=" + paperHash;
+
+    Frame paper;
+    if (!request(sock, MsgType::TEXT, query, paper)) {
         cerr << "Error: Failed to receive exam questions from server.\n";
-        return;
+        return false;
     }
 
-    string server_reply(buffer);
-
-    if (server_reply == "Error: Invalid exam selection") {
-        cout << "[+] " << server_reply << endl;
-        return;
+    if (paper.type == MsgType::ERROR) {
+        cout << "[+] " << paper.payload << endl;
+        return false;
+    }
+    if (paper.type == MsgType::ACK) return true;   // local copy is current
+    if (paper.type == MsgType::PAPER_SEALED) {
+        ofstream sealedFile(sealedPath, ios::binary);
+        sealedFile << paper.payload;
+        sealedFile.close();
+        if (!sealedFile) {
+            cerr << "Error: Unable to create file " << sealedPath << "\n";
+            remove(sealedPath.c_str());
+            Protocol::sendText(sock, "n");
+            return false;
+        }
+        return true;
+    }
+    if (paper.type == MsgType::PAPER_KEY && !unsealPaper(sealedPath, paper)) {
+        cout << "[!] Could not unlock the exam paper, please select the exam again.\n";
+        remove(sealedPath.c_str());
+        Protocol::sendText(sock, "n");
+        return false;
+    }
+    if (!decodePaper(paper)) {
+        Protocol::sendText(sock, "n");
+        return false;
     }
 
-    buffer[bytesReceived] = '\0';
-
-    // Prepare hidden directory path to store exam questions
-    const char* home = getenv("HOME");
-    string hiddenDir = string(home) + "/.config/.exam";
-    string fileName = hiddenDir + "/" + to_string(examNumber) + ".txt";
+    // The list was stale if the paper is not the one it announced (exam list changed)
+    if (!paperHash.empty() && ContentHash::of(paper.payload) != paperHash) {
+        cout << "[!] The exam list has changed, please select the exam again.\n";
+        remove(sealedPath.c_str());
+        Protocol::sendText(sock, "n");
+        return false;
+    }
 
+    string fileName = filePath;
     ofstream outFile(fileName);
     if (!outFile) {
         cerr << "Error: Unable to create file " << fileName << "\n";
-        return;
+        return false;
     }
-    outFile << buffer;
+    outFile << paper.payload;
     outFile.close();
 
-    memset(buffer,0,sizeof(buffer));
     xorEncryptDecrypt(fileName, 'X');
+    remove(sealedPath.c_str());
 
     cout << "[+] Question paper received successfully\n";
+    return true;
 }
 
 void* Client::instructorHandler(void* arg) {
     Client* client = static_cast<Client*>(arg);
-    char buffer[1024] = {0};
     int choice;
 
     while (true) {
         UI_elements::displayInstructorMenu();
         choice = userInput("",1,5);  // Get valid user choice (1-5)
-        sprintf(buffer, "%d", choice);
-        send(client->sock, buffer, strlen(buffer), 0);  // Send choice to server
+        Protocol::sendText(client->sock, to_string(choice));  // Send choice to server
 
         if (choice == 5) {
             cout << "Logging out...\n";
+            forgetSession();
             close(client->sock);
             return nullptr;
         } else if (choice == 1) { // Upload new exam
@@ -892,20 +1090,16 @@ void* Client::instructorHandler(void* arg) {
             if(type=="g" || type=="G"){
                 examName += start_time;
             }
-            send(client->sock, examName.c_str(), examName.size(), 0);
-
-            memset(buffer, 0, sizeof(buffer));
-            recv(client->sock, buffer, sizeof(buffer), 0);
-            cout <<buffer << endl;
+            Frame response;
+            if (!request(client->sock, MsgType::TEXT, examName, response)) break;
+            cout << response.payload << endl;
         } else if (choice==2){
             cout << "\nCurrently this service is not avaliable.\n";
         }
         else if(choice == 3){  // View exam analysis
-            char examBuffer[1024];
-            int bytes_recv = recv(client->sock, examBuffer, sizeof(examBuffer), 0);
-            if(bytes_recv <= 0) break;
+            string exams;
+            if (!Protocol::recvText(client->sock, exams)) break;
 
-            string exams(examBuffer);
             cout << "\n===============================================Available exams for Analysis=============================================\n";
             cout << exams << endl;
             cout << "-----------------------------------------------------------------------------------------------------------------------------\n";
@@ -914,15 +1108,10 @@ void* Client::instructorHandler(void* arg) {
             option = userInput("Enter exam number to view analysis: ",1,100);
 
             // Send selected exam number to server
-            char choiceBuffer[10]={0};
-            sprintf(choiceBuffer, "%d", option);
-            send(client->sock, choiceBuffer, strlen(choiceBuffer), 0);
-
-            char analysisBuffer[4096];
-            bytes_recv = recv(client->sock, analysisBuffer, sizeof(analysisBuffer), 0);
-            if(bytes_recv <= 0) break;
+            Frame analysis;
+            if (!request(client->sock, MsgType::TEXT, to_string(option), analysis)) break;
 
-            string firstAnalysis(analysisBuffer);
+            string firstAnalysis = analysis.payload;
             if(firstAnalysis=="[!] Invalid exam selection."){
                 cout << firstAnalysis << endl;
                 continue;
@@ -932,38 +1121,32 @@ void* Client::instructorHandler(void* arg) {
             cout << firstAnalysis << endl;
             firstAnalysis = "";
 
-            memset(analysisBuffer, 0, sizeof(analysisBuffer));
-            bytes_recv = recv(client->sock, analysisBuffer, sizeof(analysisBuffer), 0);
-            if(bytes_recv <= 0) break;
+            string output;
+            if (!Protocol::recvText(client->sock, output)) break;
 
-            cout << analysisBuffer << endl;
-            string output(analysisBuffer);
+            cout << output << endl;
             if(output=="The possible cause may be that no student has attempted this exam."){
                 continue;
             }
-            memset(analysisBuffer, 0, sizeof(analysisBuffer));
 
             // Loop to view analysis of individual students
             while(true){
                 choice = userInput("Select student sr no. to view analysis (press 0 to go back to main menu): ",0,100);
 
-                sprintf(buffer, "%d", choice);
-                send(client->sock, buffer, strlen(buffer), 0);
+                Protocol::sendText(client->sock, to_string(choice));
 
                 if(choice==0) break;
-                memset(analysisBuffer, 0, sizeof(analysisBuffer));
-                bytes_recv = recv(client->sock, analysisBuffer, sizeof(analysisBuffer), 0);
-                if(bytes_recv <= 0) return nullptr;
+                string detail;
+                if (!Protocol::recvText(client->sock, detail)) return nullptr;
 
-                cout << analysisBuffer << endl;
-                memset(analysisBuffer, 0, sizeof(analysisBuffer));
+                cout << detail << endl;
             }
         }
         else if (choice <= 4) { // Show list of uploaded exams
-            memset(buffer, 0, sizeof(buffer));
-            recv(client->sock, buffer, sizeof(buffer), 0);
+            string exams;
+            if (!Protocol::recvText(client->sock, exams)) break;
             cout << "\n\n=====================================Your uploaded exams=====================================\n";
-            cout << buffer << endl;
+            cout << exams << endl;
             cout << "-----------------------------------------------------------------------------------------------\n";
         } else {
             cout << "Invalid choice! Please select a valid option.\n";
@@ -984,8 +1167,7 @@ void Client::authenticate() {
 
         if (choice == 3) {
             cout << "Exiting...\n";
-            string request = "exit";
-            send(sock, request.c_str(), request.length(), 0);
+            Protocol::sendText(sock, "exit");
             close(sock);
             exit(0);
         }
@@ -1009,19 +1191,20 @@ void Client::authenticate() {
         string user_type = (role == "s") ? "student" : "instructor";
         string request = (choice == 1) ? "LOGIN " : "REGISTER ";
         request += user_type + " " + username + " " + password;
-        send(sock, request.c_str(), request.length(), 0);
 
-
-        // Receive and handle server response
-        char response[128] = {0};
-        int bytes_read = recv(sock, response, sizeof(response), 0);
-        if (bytes_read <= 0) {
+        // Send the request and handle server response
+        Frame response;
+        if (!Client::request(sock, MsgType::TEXT, request, response)) {
             cout << "[✖] Error: Failed to read data from server."<<endl;
             close(sock);
             return;
         }
-        string server_reply(response);
+        // "<result> <session token>" on success
+        istringstream reply(response.payload);
+        string server_reply, token;
+        reply >> server_reply >> token;
         if (server_reply == "AUTHENTICATION_SUCCESS" || server_reply == "REGISTER_SUCCESS"){
+            if (!token.empty()) saveSession(token);
             cout <<"[✔] " <<server_reply <<endl;
             usleep(1200000);
             break;
@@ -1030,8 +1213,68 @@ void Client::authenticate() {
     }
 }
 
+/**
+ * Path of the file holding the session token of the last login.
+ */
+string Client::sessionFile() {
+    const char* home = getenv("HOME");
+    return string(home) + "/.config/.session";
+}
+
+void Client::saveSession(const string& token) {
+    const char* home = getenv("HOME");
+    ensureDirectoryExists(string(home) + "/.config");
+    ofstream out(sessionFile(), ios::trunc);
+    out << token << "\n";
+    out.close();
+    chmod(sessionFile().c_str(), 0600);
+}
+
+void Client::forgetSession() {
+    remove(sessionFile().c_str());
+}
+
+/**
+ * Resumes the previous session if the client was not logged out properly
+ * (crash, dropped connection). One round trip: the server answers
+ * "RESUME_SUCCESS <role> <username> [<seconds left> <exam name>]" and, for a
+ * running exam, sends the paper right after.
+ *
+ * @return False if there is no session to resume; the user logs in normally.
+ */
+bool Client::resume() {
+    ifstream in(sessionFile());
+    string token;
+    if (!(in >> token)) return false;
+    in.close();
+
+    Frame response;
+    if (!request(sock, MsgType::TEXT, "RESUME " + token + " " + Compression::DEFLATE, response)) {
+        cout << "[✖] Error: Failed to read data from server." << endl;
+        close(sock);
+        exit(EXIT_FAILURE);
+    }
+
+    istringstream reply(response.payload);
+    string result, user_type;
+    reply >> result >> user_type >> username;
+    if (result != "RESUME_SUCCESS") {
+        forgetSession();
+        return false;
+    }
+
+    role = (user_type == "student") ? "s" : "i";
+    if (reply >> resumedSeconds) {
+        reply >> ws;
+        getline(reply, resumedExam);
+    }
+    cout << "[✔] Welcome back, " << username << endl;
+    usleep(1200000);
+    return true;
+}
+
 void Client::start() {
-    authenticate();
+    if (!resume()) authenticate();
 
     system("clear");
     usleep(200000);
@@ -25,6 +25,12 @@
 #include <thread>
 #include <atomic>
 
+#include "protocol.h"
+#include "compression.h"
+#include "content_hash.h"
+#include "seal.h"
+#include "answer_sheet.h"
+
 using namespace std;
 using namespace std::chrono;
 
@@ -36,7 +42,8 @@ class ExamInfo {
         int duration;
         int totalQuestions;
         string instructor;
-        ExamInfo(string name, string type, string start_time,int duration, int totalQ, string instructor): name(name),type(type), start_time(start_time), duration(duration), totalQuestions(totalQ), instructor(instructor) {}
+        string paperHash;   // content hash of the question paper, names the local copy
+        ExamInfo(string name, string type, string start_time,int duration, int totalQ, string instructor, string paperHash = ""): name(name),type(type), start_time(start_time), duration(duration), totalQuestions(totalQ), instructor(instructor), paperHash(paperHash) {}
 };
 
 class Client {
@@ -44,19 +51,30 @@ private:
     int sock;
     string role, username, password;
 
+    // Exam to continue after resuming a dropped session
+    string resumedExam;
+    int resumedSeconds;
+
     static map<int, int> shuffledQuestionMap; 
     static vector<vector<int>> shuffledOptionMap; 
     static vector<string> shuffledQuestions;
     static vector<vector<string>> shuffledOptions;
     static map<int, int> timeSpentPerQuestion;
+    static string preparedPaperHash;   // hash of the prepared paper, stamped on the answer sheet
 
     static void* studentHandler(void* arg);
     static void* instructorHandler(void* arg);
 
-    static void manageExam(int duration, Client* client, string examname);
-    static void decryptAndPrepareExam(const string& filePath, char key);
+    static void manageExam(int durationSeconds, Client* client, string examname, const string& savedChanges = "");
+    static string collectChanges(const vector<int>& answers, const vector<int>& seconds,
+                                 vector<int8_t>& sentAnswers, vector<uint32_t>& sentSeconds);
+    static void continueExam(Client* client);
     static void xorEncryptDecrypt(const string& filePath, char key);
-    static void receiveAndStoreExamQuestions(int sock, int examNumber); 
+    static bool receiveAndStoreExamQuestions(int sock, int examNumber, const string& paperHash, const string& filePath,
+                                             const string& sealedPath, bool cached);
+    static bool unsealPaper(const string& sealedPath, Frame& paper);
+    static bool cachedPaperValid(const string& filePath, const string& paperHash);
+    static bool decodePaper(Frame& paper);
     static void dashboard(Client * client);
     static void displayPreparedQuestion(int index);
     static void handleExamSelection(Client* client, int& choice);
@@ -65,13 +83,22 @@ private:
     static void backupExamData(string &examName, const string &finalData);
     static void sendPendingAnswerSheet(int clientSocket);
     static int userInput(const string& prompt, int minVal, int maxVal);
+    static bool request(int sock, MsgType type, const string& payload, Frame& reply);
     void authenticate();
+    bool resume();
+
+    static string sessionFile();
+    static void saveSession(const string& token);
+    static void forgetSession();
 
 public:
     static bool timeUp;
     static pthread_mutex_t timerMutex;
     Client(const string& ip, int port);
     void start();
+
+    // Decrypts a downloaded paper and shuffles its questions and options for display
+    static void decryptAndPrepareExam(const string& filePath, char key);
 };
 
 #endif
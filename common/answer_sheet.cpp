@@ -0,0 +1,156 @@
+#include "answer_sheet.h"
+
+/**
+ * Encodes an answer sheet.
+ *
+ * @param paperHash ContentHash of the paper (32 hex digits).
+ * @param answers Chosen option per question in paper order (0 = A), -1 if skipped.
+ * @param seconds Seconds spent per question, same order.
+ * @return The encoded sheet, or an empty string if the hash is malformed.
+ */
+string AnswerSheet::encode(const string& paperHash, const vector<int>& answers, const vector<int>& seconds) {
+    if (paperHash.size() != 2 * HASH_BYTES) return "";
+
+    string out(1, (char)VERSION);
+    for (size_t i = 0; i < HASH_BYTES; ++i) {
+        int high = hexValue(paperHash[2 * i]), low = hexValue(paperHash[2 * i + 1]);
+        if (high < 0 || low < 0) return "";
+        out += (char)(high << 4 | low);
+    }
+    putVarint(out, answers.size());
+
+    size_t packedStart = out.size();
+    out.append((answers.size() * ANSWER_BITS + 7) / 8, '\0');
+    for (size_t q = 0; q < answers.size(); ++q) {
+        unsigned code = answers[q] >= 0 && answers[q] <= 3 ? answers[q] + 1 : 0;
+        size_t bit = q * ANSWER_BITS;
+        // A code may straddle two bytes
+        unsigned shifted = code << (bit % 8);
+        out[packedStart + bit / 8] |= (char)(shifted & 0xff);
+        if (shifted > 0xff) out[packedStart + bit / 8 + 1] |= (char)(shifted >> 8);
+    }
+
+    for (size_t q = 0; q < answers.size(); ++q)
+        putVarint(out, q < seconds.size() && seconds[q] > 0 ? seconds[q] : 0);
+    return out;
+}
+
+/**
+ * True if a submission is in this format rather than the older text lines
+ * ("ANSWERS\n" then "question,answer,time" per line).
+ */
+bool AnswerSheet::isBinary(string_view data) {
+    return !data.empty() && (uint8_t)data[0] == VERSION;
+}
+
+/**
+ * Decodes an answer sheet for a known exam.
+ *
+ * @param data Encoded sheet.
+ * @param paperHash ContentHash of the exam's paper; the sheet must carry the same.
+ * @param questions Question count of the exam; the sheet must have the same.
+ * @param answers Receives one answer per question (-1 if skipped).
+ * @param seconds Receives the seconds spent per question.
+ * @return False if the sheet is malformed or was answered on another paper.
+ */
+bool AnswerSheet::decode(string_view data, const string& paperHash, size_t questions,
+                         int8_t* answers, uint32_t* seconds) {
+    if (!isBinary(data) || data.size() < 1 + HASH_BYTES || paperHash.size() != 2 * HASH_BYTES) return false;
+    for (size_t i = 0; i < HASH_BYTES; ++i) {
+        int high = hexValue(paperHash[2 * i]), low = hexValue(paperHash[2 * i + 1]);
+        if ((uint8_t)data[1 + i] != (high << 4 | low)) return false;
+    }
+
+    size_t pos = 1 + HASH_BYTES;
+    uint32_t count;
+    if (!getVarint(data, pos, count) || count != questions) return false;
+
+    size_t packedBytes = (questions * ANSWER_BITS + 7) / 8;
+    if (data.size() - pos < packedBytes) return false;
+    const uint8_t* packed = reinterpret_cast<const uint8_t*>(data.data() + pos);
+    for (size_t q = 0; q < questions; ++q) {
+        size_t bit = q * ANSWER_BITS;
+        unsigned word = packed[bit / 8];
+        if (bit / 8 + 1 < packedBytes) word |= packed[bit / 8 + 1] << 8;
+        unsigned code = (word >> (bit % 8)) & ((1 << ANSWER_BITS) - 1);
+        if (code > 4) return false;
+        answers[q] = (int8_t)code - 1;
+    }
+    pos += packedBytes;
+
+    for (size_t q = 0; q < questions; ++q)
+        if (!getVarint(data, pos, seconds[q])) return false;
+    return pos == data.size();
+}
+
+/**
+ * Appends one question's current state to a batch of changes.
+ *
+ * @param batch Batch being built; starts empty.
+ * @param question Question in paper order.
+ * @param answer Chosen option (0 = A), -1 if cleared.
+ * @param seconds Total seconds spent on the question so far.
+ */
+void AnswerSheet::addChange(string& batch, uint32_t question, int answer, uint32_t seconds) {
+    if (batch.empty()) batch += (char)CHANGES;
+    putVarint(batch, question);
+    batch += (char)(answer >= 0 && answer <= 3 ? answer + 1 : 0);
+    putVarint(batch, seconds);
+}
+
+/**
+ * True if a message is a batch of changes rather than a whole sheet.
+ */
+bool AnswerSheet::isChanges(string_view data) {
+    return !data.empty() && (uint8_t)data[0] == CHANGES;
+}
+
+/**
+ * Applies a batch of changes to the answers saved so far.
+ *
+ * @param batch Encoded batch (possibly with no entries).
+ * @param questions Question count of the exam.
+ * @param answers Saved answers, updated in place.
+ * @param seconds Saved times, updated in place.
+ * @return False if the batch is malformed; entries before the fault are applied.
+ */
+bool AnswerSheet::applyChanges(string_view batch, size_t questions, int8_t* answers, uint32_t* seconds) {
+    if (!isChanges(batch)) return false;
+
+    size_t pos = 1;
+    while (pos < batch.size()) {
+        uint32_t question, spent;
+        if (!getVarint(batch, pos, question) || question >= questions || pos >= batch.size()) return false;
+        uint8_t code = batch[pos++];
+        if (code > 4 || !getVarint(batch, pos, spent)) return false;
+        answers[question] = (int8_t)code - 1;
+        seconds[question] = spent;
+    }
+    return true;
+}
+
+// LEB128: 7 bits per byte, high bit set on all but the last
+void AnswerSheet::putVarint(string& out, uint32_t value) {
+    while (value >= 0x80) {
+        out += (char)(value | 0x80);
+        value >>= 7;
+    }
+    out += (char)value;
+}
+
+bool AnswerSheet::getVarint(string_view data, size_t& pos, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35 && pos < data.size(); shift += 7) {
+        uint8_t byte = data[pos++];
+        value |= (uint32_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+int AnswerSheet::hexValue(char digit) {
+    if (digit >= '0' && digit <= '9') return digit - '0';
+    if (digit >= 'a' && digit <= 'f') return digit - 'a' + 10;
+    if (digit >= 'A' && digit <= 'F') return digit - 'A' + 10;
+    return -1;
+}
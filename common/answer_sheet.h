@@ -0,0 +1,47 @@
+#ifndef ANSWER_SHEET_H
+#define ANSWER_SHEET_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+// Binary answer sheet submitted at the end of an exam:
+//   [version: 1 byte][paper hash: 16 bytes][question count: varint]
+//   [answers: 3 bits each, 0 = skipped, 1-4 = A-D, packed from the low bit]
+//   [seconds spent: one varint per question]
+// Questions are in paper order. The hash is the exam's ContentHash, so a
+// sheet can only be graded against the paper it was answered on. Decoding
+// writes into arrays owned by the caller and does not allocate.
+//
+// While an exam runs the client autosaves batches of changes instead:
+//   [CHANGES: 1 byte] then per changed question
+//   [question: varint][answer code: 1 byte][seconds spent so far: varint]
+// Entries carry absolute values, so applying a batch twice is harmless.
+class AnswerSheet {
+public:
+    static const uint8_t VERSION = 1;
+    static const uint8_t CHANGES = 2;
+    static const size_t HASH_BYTES = 16;
+
+    static string encode(const string& paperHash, const vector<int>& answers, const vector<int>& seconds);
+    static bool isBinary(string_view data);
+    static bool decode(string_view data, const string& paperHash, size_t questions,
+                       int8_t* answers, uint32_t* seconds);
+
+    static void addChange(string& batch, uint32_t question, int answer, uint32_t seconds);
+    static bool isChanges(string_view data);
+    static bool applyChanges(string_view batch, size_t questions, int8_t* answers, uint32_t* seconds);
+
+private:
+    static const int ANSWER_BITS = 3;
+
+    static void putVarint(string& out, uint32_t value);
+    static bool getVarint(string_view data, size_t& pos, uint32_t& value);
+    static int hexValue(char digit);
+};
+
+#endif
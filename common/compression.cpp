@@ -0,0 +1,53 @@
+#include "compression.h"
+
+const char* const Compression::DEFLATE = "deflate";
+
+/**
+ * Compresses a payload.
+ *
+ * @param data Bytes to compress.
+ * @param compressed Receives the length prefix and zlib stream.
+ * @param level zlib level (1 fastest ... 9 smallest).
+ * @return False if zlib failed.
+ */
+bool Compression::deflate(const string& data, string& compressed, int level) {
+    uLongf bound = compressBound(data.size());
+    compressed.assign(4 + bound, '\0');
+
+    uint32_t len = data.size();
+    compressed[0] = static_cast<char>((len >> 24) & 0xFF);
+    compressed[1] = static_cast<char>((len >> 16) & 0xFF);
+    compressed[2] = static_cast<char>((len >> 8) & 0xFF);
+    compressed[3] = static_cast<char>(len & 0xFF);
+
+    if (compress2(reinterpret_cast<Bytef*>(&compressed[4]), &bound,
+                  reinterpret_cast<const Bytef*>(data.data()), data.size(), level) != Z_OK) {
+        return false;
+    }
+    compressed.resize(4 + bound);
+    return true;
+}
+
+/**
+ * Restores a payload produced by deflate().
+ *
+ * @param compressed Length prefix and zlib stream.
+ * @param data Receives the original bytes.
+ * @return False if the input is truncated or corrupt.
+ */
+bool Compression::inflate(const string& compressed, string& data) {
+    if (compressed.size() < 4) return false;
+
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(compressed.data());
+    uint32_t len = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+
+    data.assign(len, '\0');
+    uLongf size = len;
+    if (uncompress(reinterpret_cast<Bytef*>(&data[0]), &size,
+                   reinterpret_cast<const Bytef*>(compressed.data() + 4), compressed.size() - 4) != Z_OK ||
+        size != len) {
+        data.clear();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,21 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <string>
+#include <cstdint>
+#include <zlib.h>
+
+using namespace std;
+
+// zlib (deflate) codec for frame payloads. A compressed payload starts with
+// the uncompressed length (4 bytes, big-endian) followed by the zlib stream,
+// so the receiver can size its buffer in one go.
+class Compression {
+public:
+    static const char* const DEFLATE;   // codec name clients advertise
+
+    static bool deflate(const string& data, string& compressed, int level = Z_BEST_COMPRESSION);
+    static bool inflate(const string& compressed, string& data);
+};
+
+#endif
@@ -0,0 +1,23 @@
+#include "content_hash.h"
+
+#define HASH_BYTES 16
+
+/**
+ * Hashes a paper.
+ *
+ * @param data Bytes to hash.
+ * @return 32 lowercase hex digits, or an empty string if hashing failed.
+ */
+string ContentHash::of(string_view data) {
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int length = 0;
+    if (EVP_Digest(data.data(), data.size(), digest, &length, EVP_sha256(), nullptr) != 1) return "";
+
+    static const char digits[] = "0123456789abcdef";
+    string hex;
+    for (int i = 0; i < HASH_BYTES; ++i) {
+        hex += digits[digest[i] >> 4];
+        hex += digits[digest[i] & 0xf];
+    }
+    return hex;
+}
@@ -0,0 +1,18 @@
+#ifndef CONTENT_HASH_H
+#define CONTENT_HASH_H
+
+#include <string>
+#include <string_view>
+#include <openssl/evp.h>
+
+using namespace std;
+
+// Short content hash used to name and validate cached exam papers: the first
+// 128 bits of SHA-256, as 32 hex digits. Client and server compute it over
+// the plain (unencrypted, uncompressed) paper.
+class ContentHash {
+public:
+    static string of(string_view data);
+};
+
+#endif
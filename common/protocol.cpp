@@ -0,0 +1,141 @@
+#include "protocol.h"
+
+// Default ceiling for a single payload; the server overrides it from its config
+size_t Protocol::maxPayload = 64 * 1024 * 1024;
+
+/**
+ * Encodes one frame.
+ *
+ * @param type Message type.
+ * @param payload Message body (any bytes).
+ * @return Header followed by the payload, ready to be written to a socket.
+ */
+string Protocol::encode(MsgType type, const string& payload) {
+    string frame;
+    frame.reserve(HEADER_SIZE + payload.size());
+    frame = encodeHeader(type, payload.size());
+    frame += payload;
+    return frame;
+}
+
+/**
+ * Encodes just the frame header, for payloads that are written separately
+ * (e.g. straight from a file).
+ *
+ * @param type Message type.
+ * @param length Payload length in bytes.
+ * @return The HEADER_SIZE header bytes.
+ */
+string Protocol::encodeHeader(MsgType type, uint32_t length) {
+    string header;
+    header.push_back(static_cast<char>(type));
+    header.push_back(static_cast<char>((length >> 24) & 0xFF));
+    header.push_back(static_cast<char>((length >> 16) & 0xFF));
+    header.push_back(static_cast<char>((length >> 8) & 0xFF));
+    header.push_back(static_cast<char>(length & 0xFF));
+    return header;
+}
+
+/**
+ * Takes one complete frame off the front of a receive buffer.
+ *
+ * @param buffer Bytes received so far; consumed bytes are erased.
+ * @param frame Receives the decoded frame.
+ * @return 1 if a frame was decoded, 0 if more bytes are needed,
+ *         -1 if the frame is larger than maxPayload.
+ */
+int Protocol::decode(string& buffer, Frame& frame) {
+    if (buffer.size() < HEADER_SIZE) return 0;
+
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(buffer.data());
+    uint32_t len = (uint32_t(p[1]) << 24) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 8) | uint32_t(p[4]);
+    if (len > maxPayload) return -1;
+    if (buffer.size() < HEADER_SIZE + len) return 0;
+
+    frame.type = static_cast<MsgType>(p[0]);
+    frame.payload.assign(buffer, HEADER_SIZE, len);
+    buffer.erase(0, HEADER_SIZE + len);
+    return 1;
+}
+
+/**
+ * Writes a whole buffer to a blocking socket.
+ */
+bool Protocol::sendAll(int sock, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t sent = send(sock, data, len, MSG_NOSIGNAL);
+        if (sent == -1) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += sent;
+        len -= sent;
+    }
+    return true;
+}
+
+/**
+ * Reads exactly len bytes from a blocking socket.
+ */
+bool Protocol::recvAll(int sock, char* data, size_t len) {
+    while (len > 0) {
+        ssize_t got = recv(sock, data, len, 0);
+        if (got == 0) return false;
+        if (got == -1) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += got;
+        len -= got;
+    }
+    return true;
+}
+
+/**
+ * Sends one frame on a blocking socket.
+ *
+ * @param sock Connected socket.
+ * @param type Message type.
+ * @param payload Message body.
+ * @return True if the whole frame was written.
+ */
+bool Protocol::sendFrame(int sock, MsgType type, const string& payload) {
+    string frame = encode(type, payload);
+    return sendAll(sock, frame.data(), frame.size());
+}
+
+/**
+ * Receives one frame from a blocking socket.
+ *
+ * @param sock Connected socket.
+ * @param frame Receives the decoded frame.
+ * @return False if the connection closed, failed or sent an oversized frame.
+ */
+bool Protocol::recvFrame(int sock, Frame& frame) {
+    unsigned char header[HEADER_SIZE];
+    if (!recvAll(sock, reinterpret_cast<char*>(header), HEADER_SIZE)) return false;
+
+    uint32_t len = (uint32_t(header[1]) << 24) | (uint32_t(header[2]) << 16) | (uint32_t(header[3]) << 8) | uint32_t(header[4]);
+    if (len > maxPayload) return false;
+
+    frame.type = static_cast<MsgType>(header[0]);
+    frame.payload.resize(len);
+    return len == 0 || recvAll(sock, &frame.payload[0], len);
+}
+
+/**
+ * Sends a TEXT frame.
+ */
+bool Protocol::sendText(int sock, const string& text) {
+    return sendFrame(sock, MsgType::TEXT, text);
+}
+
+/**
+ * Receives a frame and returns its payload, whatever its type.
+ */
+bool Protocol::recvText(int sock, string& text) {
+    Frame frame;
+    if (!recvFrame(sock, frame)) return false;
+    text = move(frame.payload);
+    return true;
+}
@@ -0,0 +1,55 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Kind of payload carried by a frame
+enum class MsgType : uint8_t {
+    TEXT = 1,       // requests, menu choices, prompts and reports
+    PAPER = 2,      // question paper
+    ANSWERS = 3,    // answer sheet submitted by a student
+    ACK = 4,        // short yes/no answers ("y" / "n")
+    BUSY = 5,       // server overloaded; payload is the retry delay in ms
+    ERROR = 6,      // request failed; payload is the reason
+    PAPER_DEFLATE = 7,  // question paper compressed with Compression::deflate
+    PAPER_SEALED = 8,   // compressed paper sealed with the exam key (see Seal), sent before the start
+    PAPER_KEY = 9,      // key of a sealed paper, released at the start
+    ANSWERS_DELTA = 10  // autosaved answer changes (see AnswerSheet), never replied to
+};
+
+// One decoded message
+struct Frame {
+    MsgType type;
+    string payload;
+};
+
+// Wire format shared by client and server:
+//   [type: 1 byte][payload length: 4 bytes, big-endian][payload]
+class Protocol {
+public:
+    static const size_t HEADER_SIZE = 5;
+    static size_t maxPayload;   // frames announcing more than this are rejected
+
+    static string encode(MsgType type, const string& payload);
+    static string encodeHeader(MsgType type, uint32_t length);
+    static int decode(string& buffer, Frame& frame);
+
+    // Blocking helpers for the client side
+    static bool sendFrame(int sock, MsgType type, const string& payload);
+    static bool recvFrame(int sock, Frame& frame);
+    static bool sendText(int sock, const string& text);
+    static bool recvText(int sock, string& text);
+
+private:
+    static bool sendAll(int sock, const char* data, size_t len);
+    static bool recvAll(int sock, char* data, size_t len);
+};
+
+#endif
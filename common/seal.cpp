@@ -0,0 +1,76 @@
+#include "seal.h"
+
+#define NONCE_SIZE 12
+#define TAG_SIZE 16
+
+/**
+ * Generates a random key.
+ */
+bool Seal::newKey(string& key) {
+    key.assign(KEY_SIZE, '\0');
+    return RAND_bytes(reinterpret_cast<unsigned char*>(&key[0]), KEY_SIZE) == 1;
+}
+
+/**
+ * Encrypts and authenticates a payload with a fresh random nonce.
+ *
+ * @param key KEY_SIZE bytes.
+ * @param plain Bytes to protect.
+ * @param sealed Receives nonce, ciphertext and tag.
+ * @return False if the key is malformed or OpenSSL failed.
+ */
+bool Seal::seal(const string& key, const string& plain, string& sealed) {
+    if (key.size() != KEY_SIZE) return false;
+
+    sealed.assign(NONCE_SIZE + plain.size() + TAG_SIZE, '\0');
+    unsigned char* nonce = reinterpret_cast<unsigned char*>(&sealed[0]);
+    unsigned char* body = nonce + NONCE_SIZE;
+    if (RAND_bytes(nonce, NONCE_SIZE) != 1) return false;
+
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    int len = 0, total = 0;
+    bool ok = ctx &&
+              EVP_EncryptInit_ex(ctx, EVP_aes_256_gcm(), nullptr,
+                                 reinterpret_cast<const unsigned char*>(key.data()), nonce) == 1 &&
+              EVP_EncryptUpdate(ctx, body, &len, reinterpret_cast<const unsigned char*>(plain.data()),
+                                plain.size()) == 1;
+    total = len;
+    ok = ok && EVP_EncryptFinal_ex(ctx, body + total, &len) == 1;
+    total += len;
+    ok = ok && EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, TAG_SIZE, body + total) == 1;
+    EVP_CIPHER_CTX_free(ctx);
+    return ok && (size_t)total == plain.size();
+}
+
+/**
+ * Checks and decrypts a sealed payload.
+ *
+ * @param key KEY_SIZE bytes.
+ * @param sealed Output of seal().
+ * @param plain Receives the original bytes.
+ * @return False if the payload was tampered with or the key is wrong.
+ */
+bool Seal::open(const string& key, const string& sealed, string& plain) {
+    if (key.size() != KEY_SIZE || sealed.size() < NONCE_SIZE + TAG_SIZE) return false;
+
+    const unsigned char* nonce = reinterpret_cast<const unsigned char*>(sealed.data());
+    const unsigned char* body = nonce + NONCE_SIZE;
+    size_t bodySize = sealed.size() - NONCE_SIZE - TAG_SIZE;
+    string tag = sealed.substr(sealed.size() - TAG_SIZE);
+
+    plain.assign(bodySize, '\0');
+    unsigned char* out = reinterpret_cast<unsigned char*>(&plain[0]);
+
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    int len = 0, total = 0;
+    bool ok = ctx &&
+              EVP_DecryptInit_ex(ctx, EVP_aes_256_gcm(), nullptr,
+                                 reinterpret_cast<const unsigned char*>(key.data()), nonce) == 1 &&
+              EVP_DecryptUpdate(ctx, out, &len, body, bodySize) == 1;
+    total = len;
+    ok = ok && EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, TAG_SIZE, &tag[0]) == 1 &&
+         EVP_DecryptFinal_ex(ctx, out + total, &len) == 1;
+    EVP_CIPHER_CTX_free(ctx);
+    if (!ok) plain.clear();
+    return ok;
+}
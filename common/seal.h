@@ -0,0 +1,22 @@
+#ifndef SEAL_H
+#define SEAL_H
+
+#include <string>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+using namespace std;
+
+// Authenticated encryption (AES-256-GCM) of a payload under a 32-byte key.
+// A sealed payload is [12-byte nonce][ciphertext][16-byte tag]; opening it
+// fails if any byte was changed or the key is wrong.
+class Seal {
+public:
+    static const size_t KEY_SIZE = 32;
+
+    static bool newKey(string& key);
+    static bool seal(const string& key, const string& plain, string& sealed);
+    static bool open(const string& key, const string& sealed, string& plain);
+};
+
+#endif
@@ -0,0 +1,341 @@
+#include "loadgen.h"
+
+/**
+ * Prepares a run; nothing connects until run() is called.
+ *
+ * @param options Number of students, exam, arrival pattern and think times.
+ */
+LoadGenerator::LoadGenerator(const LoadOptions& options) : options(options), elapsedSeconds(0) {
+    pthread_mutex_init(&gate.mutex, nullptr);
+    pthread_cond_init(&gate.cond, nullptr);
+    initGate(0);
+}
+
+LoadGenerator::~LoadGenerator() {
+    pthread_mutex_destroy(&gate.mutex);
+    pthread_cond_destroy(&gate.cond);
+}
+
+const char* LoadGenerator::stepName(int step) {
+    static const char* names[STEP_COUNT] = {"connect", "auth", "list", "download", "start", "submit"};
+    return names[step];
+}
+
+/**
+ * Starts every simulated student at its arrival time and waits for all of
+ * them to finish.
+ *
+ * @return False if no student thread could be started.
+ */
+bool LoadGenerator::run() {
+    // Arrival offsets: evenly spread, or exponential gaps for a Poisson process
+    mt19937 rng(options.seed);
+    exponential_distribution<double> gap(options.students / max(options.rampSeconds, 0.001));
+    double at = 0.0;
+
+    students.assign(options.students, Student());
+    for (int i = 0; i < options.students; ++i) {
+        Student& s = students[i];
+        s.owner = this;
+        s.index = i;
+        s.completed = false;
+        s.rejected = false;
+        s.sockfd = -1;
+        if (options.arrival == "poisson") {
+            s.arrivalSeconds = at;
+            at += gap(rng);
+        } else {
+            s.arrivalSeconds = options.rampSeconds * i / options.students;
+        }
+    }
+
+    bool gated = options.arrival == "start" || options.arrival == "deadline";
+    initGate(gated ? options.students : 0);
+
+    // Thousands of threads: keep their stacks small
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, 256 * 1024);
+
+    begin = chrono::steady_clock::now();
+    vector<pthread_t> threads;
+    for (Student& s : students) {
+        pthread_t thread;
+        if (pthread_create(&thread, &attr, studentThread, &s) != 0) {
+            cerr << "Error: Unable to start student thread " << s.index << endl;
+            if (gated) leaveGate();
+            continue;
+        }
+        threads.push_back(thread);
+    }
+    pthread_attr_destroy(&attr);
+
+    for (pthread_t thread : threads) pthread_join(thread, nullptr);
+    elapsedSeconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    return !threads.empty();
+}
+
+void* LoadGenerator::studentThread(void* arg) {
+    Student* student = static_cast<Student*>(arg);
+    student->completed = student->owner->simulate(*student);
+    return nullptr;
+}
+
+/**
+ * Walks one student through login, exam list, paper download, answering and
+ * submission, timing every exchange with the server.
+ *
+ * @param student Student to simulate; its step statistics are filled in.
+ * @return True if the answer sheet was acknowledged (or a scheduled exam was
+ *         refused because it had already been attempted).
+ */
+bool LoadGenerator::simulate(Student& student) {
+    mt19937 rng(options.seed * 7919 + student.index);
+    bool gated = options.arrival == "start" || options.arrival == "deadline";
+    bool passedGate = false;
+    int& sock = student.sockfd;
+
+    // On any failure, give up this student without holding the others at the gate
+    auto fail = [&]() {
+        if (gated && !passedGate) leaveGate();
+        if (sock >= 0) close(sock);
+        return false;
+    };
+
+    // Wait for this student's arrival time
+    auto arrival = begin + chrono::microseconds((int64_t)(student.arrivalSeconds * 1e6));
+    auto wait = arrival - chrono::steady_clock::now();
+    if (wait.count() > 0) usleep(chrono::duration_cast<chrono::microseconds>(wait).count());
+
+    auto t0 = chrono::steady_clock::now();
+    sock = connectToServer();
+    if (sock < 0) {
+        student.steps[STEP_CONNECT].failures++;
+        return fail();
+    }
+    student.steps[STEP_CONNECT].micros.push_back(
+        chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - t0).count());
+
+    // Register, or log in if the account exists from an earlier run (replies
+    // carry a session token after the result, which the generator ignores)
+    string name = options.prefix + to_string(student.index);
+    Frame reply;
+    if (!timed(student, STEP_AUTH, MsgType::TEXT, "REGISTER student " + name + " " + options.password, reply)) return fail();
+    if (reply.payload.rfind("REGISTER_SUCCESS", 0) != 0) {
+        if (!timed(student, STEP_AUTH, MsgType::TEXT, "LOGIN student " + name + " " + options.password, reply)) return fail();
+        if (reply.payload.rfind("AUTHENTICATION_SUCCESS", 0) != 0) {
+            student.steps[STEP_AUTH].failures++;
+            return fail();
+        }
+    }
+
+    // No backed-up answer sheet to send
+    Protocol::sendText(sock, "n");
+
+    // "Everyone at scheduled start": the whole class opens the exam together
+    if (options.arrival == "start") {
+        waitAtGate();
+        passedGate = true;
+    }
+
+    if (!timed(student, STEP_LIST, MsgType::TEXT, "1", reply)) return fail();
+
+    // Find the exam line ("<n>. Exam Name: ... | Exam type: g | ... | Total Questions: 10 | ...")
+    string prefix = to_string(options.exam) + ". ";
+    string line;
+    istringstream list(reply.payload);
+    while (getline(list, line) && line.compare(0, prefix.size(), prefix) != 0) {}
+    size_t typePos = line.find("Exam type: ");
+    size_t countPos = line.find("Total Questions: ");
+    if (line.compare(0, prefix.size(), prefix) != 0 || typePos == string::npos || countPos == string::npos) {
+        student.steps[STEP_LIST].failures++;
+        Protocol::sendText(sock, "0");
+        return fail();
+    }
+    bool scheduled = line[typePos + 11] == 'g';
+    int questions = atoi(line.c_str() + countPos + 17);
+
+    if (!timed(student, STEP_DOWNLOAD, MsgType::TEXT, to_string(options.exam), reply)) return fail();
+    if (reply.type != MsgType::PAPER) {
+        student.steps[STEP_DOWNLOAD].failures++;
+        return fail();
+    }
+
+    // Start the exam; scheduled exams first check for an earlier attempt
+    Protocol::sendText(sock, "y");
+    if (scheduled) {
+        if (!timed(student, STEP_START, MsgType::TEXT, "s", reply)) return fail();
+        if (reply.payload == "y") {
+            student.rejected = true;
+            if (gated && !passedGate) leaveGate();
+            Protocol::sendText(sock, "3");
+            close(sock);
+            return true;
+        }
+    } else {
+        Protocol::sendText(sock, "m");
+    }
+
+    // Answer the paper question by question, autosaving each answer like the client
+    uniform_int_distribution<int> option(0, 3), percent(0, 99);
+    for (int q = 0; q < questions; ++q) {
+        uint32_t ms = thinkMillis(rng);
+        usleep(ms * 1000);
+        int answer = percent(rng) < options.answerPercent ? option(rng) : -1;
+        string change;
+        AnswerSheet::addChange(change, q, answer, (ms + 500) / 1000);
+        if (!Protocol::sendFrame(sock, MsgType::ANSWERS_DELTA, change)) return fail();
+    }
+
+    // "Everyone submits at deadline": hold the sheet until the whole class is done
+    if (options.arrival == "deadline") {
+        waitAtGate();
+        passedGate = true;
+    }
+
+    if (!timed(student, STEP_SUBMIT, MsgType::ANSWERS, string(1, (char)AnswerSheet::CHANGES), reply)) return fail();
+    bool acked = reply.type == MsgType::ACK && reply.payload == "y";
+    if (!acked) student.steps[STEP_SUBMIT].failures++;
+
+    Protocol::sendText(sock, "3");
+    close(sock);
+    return acked;
+}
+
+/**
+ * Sends one request and waits for its answer, resending after the advertised
+ * delay while the server replies BUSY. The recorded latency covers the retries.
+ *
+ * @return False (and counts a failure) if the connection broke.
+ */
+bool LoadGenerator::timed(Student& student, Step step, MsgType type, const string& payload, Frame& reply) {
+    auto t0 = chrono::steady_clock::now();
+    while (true) {
+        if (!Protocol::sendFrame(student.sockfd, type, payload) || !Protocol::recvFrame(student.sockfd, reply)) {
+            student.steps[step].failures++;
+            return false;
+        }
+        if (reply.type != MsgType::BUSY) break;
+
+        int retryMs = atoi(reply.payload.c_str());
+        usleep((retryMs > 0 ? retryMs : 200) * 1000);
+    }
+    student.steps[step].micros.push_back(
+        chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - t0).count());
+    return true;
+}
+
+/**
+ * Opens a TCP connection to the server under test.
+ *
+ * @return Connected socket, or -1.
+ */
+int LoadGenerator::connectToServer() {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) return -1;
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(options.port);
+    if (inet_pton(AF_INET, options.host.c_str(), &addr.sin_addr) <= 0 ||
+        connect(sock, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(sock);
+        return -1;
+    }
+
+    // Requests without a reply are followed straight by the next one; without
+    // this Nagle holds the second frame for the server's delayed ACK (~40 ms)
+    int one = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return sock;
+}
+
+/**
+ * Draws the time a student spends on one question.
+ */
+uint32_t LoadGenerator::thinkMillis(mt19937& rng) const {
+    if (options.think == "fixed") return (uint32_t)options.thinkMs;
+    if (options.think == "uniform") return (uint32_t)uniform_real_distribution<double>(0, 2 * options.thinkMs)(rng);
+    return (uint32_t)exponential_distribution<double>(1.0 / max(options.thinkMs, 1.0))(rng);
+}
+
+void LoadGenerator::initGate(int expected) {
+    pthread_mutex_lock(&gate.mutex);
+    gate.expected = expected;
+    gate.arrived = 0;
+    gate.open = expected == 0;
+    pthread_mutex_unlock(&gate.mutex);
+}
+
+/**
+ * Blocks until every student still running has reached the gate.
+ */
+void LoadGenerator::waitAtGate() {
+    pthread_mutex_lock(&gate.mutex);
+    gate.arrived++;
+    if (gate.arrived >= gate.expected) {
+        gate.open = true;
+        pthread_cond_broadcast(&gate.cond);
+    }
+    while (!gate.open) pthread_cond_wait(&gate.cond, &gate.mutex);
+    pthread_mutex_unlock(&gate.mutex);
+}
+
+/**
+ * Removes a student that will never reach the gate.
+ */
+void LoadGenerator::leaveGate() {
+    pthread_mutex_lock(&gate.mutex);
+    gate.expected--;
+    if (gate.arrived >= gate.expected) {
+        gate.open = true;
+        pthread_cond_broadcast(&gate.cond);
+    }
+    pthread_mutex_unlock(&gate.mutex);
+}
+
+/**
+ * Prints completed sessions, then per step: samples, failures, throughput
+ * over the whole run and latency percentiles.
+ *
+ * @param out Stream to print to.
+ */
+void LoadGenerator::report(ostream& out) const {
+    int completed = 0, rejected = 0;
+    for (const Student& s : students) {
+        if (s.completed) completed++;
+        if (s.rejected) rejected++;
+    }
+
+    out << "\n[+] " << students.size() << " students, arrival '" << options.arrival << "' over "
+        << options.rampSeconds << " s, think '" << options.think << "' " << options.thinkMs << " ms/question\n";
+    out << "[+] completed: " << completed << "  (already attempted: " << rejected << ")  in "
+        << fixed << setprecision(2) << elapsedSeconds << " s\n\n";
+
+    out << "| Step     |  Count | Failed |  Ops/s  |  p50 ms  |  p95 ms  |  p99 ms  |  max ms  |\n";
+    out << "-------------------------------------------------------------------------------------\n";
+    for (int step = 0; step < STEP_COUNT; ++step) {
+        vector<uint32_t> all;
+        int failures = 0;
+        for (const Student& s : students) {
+            all.insert(all.end(), s.steps[step].micros.begin(), s.steps[step].micros.end());
+            failures += s.steps[step].failures;
+        }
+        if (all.empty() && failures == 0) continue;
+        sort(all.begin(), all.end());
+
+        // Nearest-rank percentile, in milliseconds
+        auto pct = [&all](double p) {
+            if (all.empty()) return 0.0;
+            size_t rank = (size_t)ceil(p * all.size());
+            return all[max(rank, (size_t)1) - 1] / 1000.0;
+        };
+
+        out << "| " << setw(8) << left << stepName(step) << " | " << right;
+        out << setw(6) << all.size() << " | " << setw(6) << failures << " | ";
+        out << setw(7) << setprecision(1) << all.size() / max(elapsedSeconds, 1e-9) << " | ";
+        out << setprecision(2) << setw(8) << pct(0.50) << " | " << setw(8) << pct(0.95) << " | ";
+        out << setw(8) << pct(0.99) << " | " << setw(8) << pct(1.0) << " |\n";
+    }
+    out << "-------------------------------------------------------------------------------------\n";
+}
@@ -0,0 +1,108 @@
+#ifndef LOADGEN_H
+#define LOADGEN_H
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <cstring>
+#include <pthread.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "protocol.h"
+#include "answer_sheet.h"
+
+using namespace std;
+
+// What the simulated students do and when
+struct LoadOptions {
+    string host = "127.0.0.1";
+    int port = 8080;
+    int students = 100;
+    int exam = 1;                   // exam number as listed to students
+    string prefix = "lg";           // student usernames are <prefix><index>
+    string password = "pw";
+
+    // ramp:     arrivals evenly spread over rampSeconds
+    // poisson:  random arrivals averaging students / rampSeconds per second
+    // start:    log in over rampSeconds, then everyone downloads the paper at once
+    // deadline: arrive over rampSeconds, then everyone submits at once
+    string arrival = "ramp";
+    double rampSeconds = 10.0;
+
+    // Time spent on each question: fixed | uniform (0 .. 2*mean) | exp
+    string think = "exp";
+    double thinkMs = 500.0;
+    int answerPercent = 80;         // chance that a question is answered rather than skipped
+    unsigned seed = 1;
+};
+
+// Protocol steps timed for every student
+enum Step { STEP_CONNECT, STEP_AUTH, STEP_LIST, STEP_DOWNLOAD, STEP_START, STEP_SUBMIT, STEP_COUNT };
+
+// Latencies and failures of one step
+struct StepStats {
+    vector<uint32_t> micros;
+    int failures = 0;
+};
+
+// Runs one thread per simulated student against a live server and reports
+// throughput and latency percentiles per protocol step
+class LoadGenerator {
+public:
+    explicit LoadGenerator(const LoadOptions& options);
+    ~LoadGenerator();
+
+    bool run();
+    void report(ostream& out) const;
+
+    static const char* stepName(int step);
+
+private:
+    // Lets every student that is still running cross a point together;
+    // students that fail drop out so the others are not held up
+    struct Gate {
+        pthread_mutex_t mutex;
+        pthread_cond_t cond;
+        int expected;
+        int arrived;
+        bool open;
+    };
+
+    struct Student {
+        LoadGenerator* owner;
+        int index;
+        double arrivalSeconds;      // offset from the start of the run
+        int sockfd;
+        StepStats steps[STEP_COUNT];
+        bool completed;
+        bool rejected;              // scheduled exam already attempted
+    };
+
+    LoadOptions options;
+    vector<Student> students;
+    Gate gate;
+    chrono::steady_clock::time_point begin;
+    double elapsedSeconds;
+
+    static void* studentThread(void* arg);
+    bool simulate(Student& student);
+    bool timed(Student& student, Step step, MsgType type, const string& payload, Frame& reply);
+    int connectToServer();
+    uint32_t thinkMillis(mt19937& rng) const;
+
+    void initGate(int expected);
+    void waitAtGate();
+    void leaveGate();
+};
+
+#endif
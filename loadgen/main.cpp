@@ -0,0 +1,44 @@
+#include "loadgen.h"
+
+static void usage(const char* program) {
+    cerr << "Usage: " << program << " [-n students] [-e exam number] [-a ramp|poisson|start|deadline]\n"
+         << "       [-r ramp seconds] [-t fixed|uniform|exp] [-m think ms per question]\n"
+         << "       [-A answered %] [-u username prefix] [-H host] [-p port] [-s seed]\n";
+}
+
+int main(int argc, char* argv[]) {
+    LoadOptions options;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:e:a:r:t:m:A:u:H:p:s:h")) != -1) {
+        switch (opt) {
+            case 'n': options.students = atoi(optarg); break;
+            case 'e': options.exam = atoi(optarg); break;
+            case 'a': options.arrival = optarg; break;
+            case 'r': options.rampSeconds = atof(optarg); break;
+            case 't': options.think = optarg; break;
+            case 'm': options.thinkMs = atof(optarg); break;
+            case 'A': options.answerPercent = atoi(optarg); break;
+            case 'u': options.prefix = optarg; break;
+            case 'H': options.host = optarg; break;
+            case 'p': options.port = atoi(optarg); break;
+            case 's': options.seed = strtoul(optarg, nullptr, 10); break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+
+    if (options.students <= 0 || options.exam <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (options.arrival != "ramp" && options.arrival != "poisson" &&
+        options.arrival != "start" && options.arrival != "deadline") {
+        cerr << "Error: unknown arrival pattern '" << options.arrival << "'" << endl;
+        return 1;
+    }
+
+    LoadGenerator generator(options);
+    if (!generator.run()) return 1;
+    generator.report(cout);
+    return 0;
+}
@@ -0,0 +1,75 @@
+#include "attempt_index.h"
+
+AttemptIndex::Shard AttemptIndex::shards[AttemptIndex::SHARDS];
+
+/**
+ * Slot of a student, growing the shard's array if needed. Called with the
+ * shard's write lock held.
+ */
+AttemptIndex::Student& AttemptIndex::studentFor(Shard& shard, uint32_t studentId) {
+    size_t slot = studentId / SHARDS;
+    if (slot >= shard.students.size()) shard.students.resize(slot + 1);
+    return shard.students[slot];
+}
+
+/**
+ * Records one committed attempt. Records arrive in journal order, so each
+ * exam's list stays sorted by LSN; adding the same record twice is a no-op.
+ *
+ * @param s Graded submission.
+ * @param lsn Journal position of the submission.
+ */
+void AttemptIndex::add(const Submission& s, uint64_t lsn) {
+    uint32_t studentId = NameDictionary::intern(NameKind::STUDENT, s.studentId);
+    uint32_t examId = NameDictionary::intern(NameKind::EXAM, s.examName);
+    Shard& shard = shards[studentId % SHARDS];
+    pthread_rwlock_wrlock(&shard.lock);
+    vector<AttemptRef>& attempts = studentFor(shard, studentId).exams[examId];
+    if (attempts.empty() || attempts.back().lsn < lsn)
+        attempts.push_back({lsn, s.timestamp, s.totalMarks(), int(s.answers.size()) * 4});
+    pthread_rwlock_unlock(&shard.lock);
+}
+
+/**
+ * Attempts of one student.
+ *
+ * @param studentId Student ID.
+ * @return Exam name -> attempts, oldest first; empty if the student has none.
+ */
+map<string, vector<AttemptRef>> AttemptIndex::forStudent(const string& studentId) {
+    map<string, vector<AttemptRef>> result;
+    uint32_t id;
+    if (!NameDictionary::find(NameKind::STUDENT, studentId, id)) return result;
+
+    unordered_map<uint32_t, vector<AttemptRef>> exams;
+    Shard& shard = shards[id % SHARDS];
+    pthread_rwlock_rdlock(&shard.lock);
+    if (id / SHARDS < shard.students.size()) exams = shard.students[id / SHARDS].exams;
+    pthread_rwlock_unlock(&shard.lock);
+
+    // Exam names are resolved only for the dashboard
+    for (auto& [examId, attempts] : exams) result[NameDictionary::name(NameKind::EXAM, examId)] = move(attempts);
+    return result;
+}
+
+/**
+ * Starts a scheduled exam for a student, unless the student already has an
+ * attempt at it or has started it before. Check and claim happen under the
+ * shard's write lock, so of two concurrent starts only one succeeds. Starts
+ * are kept in memory only; after a restart a start that never committed an
+ * attempt can be made again.
+ *
+ * @param studentId Student ID.
+ * @param examName Scheduled exam.
+ * @return True if the student may take the exam.
+ */
+bool AttemptIndex::claim(const string& studentId, const string& examName) {
+    uint32_t id = NameDictionary::intern(NameKind::STUDENT, studentId);
+    uint32_t examId = NameDictionary::intern(NameKind::EXAM, examName);
+    Shard& shard = shards[id % SHARDS];
+    pthread_rwlock_wrlock(&shard.lock);
+    Student& student = studentFor(shard, id);
+    bool claimed = !student.exams.count(examId) && student.started.insert(examId).second;
+    pthread_rwlock_unlock(&shard.lock);
+    return claimed;
+}
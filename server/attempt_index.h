@@ -0,0 +1,57 @@
+#ifndef ATTEMPT_INDEX_H
+#define ATTEMPT_INDEX_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstdint>
+#include <pthread.h>
+
+#include "submission.h"
+#include "name_dictionary.h"
+
+using namespace std;
+
+// Summary of one attempt. The journal LSN is the attempt's ID: unique and
+// increasing, so attempts made within the same second stay apart, and it
+// finds the full record in the exam's leaderboard.
+struct AttemptRef {
+    uint64_t lsn;
+    string timestamp;
+    int marks;
+    int totalMarks;
+};
+
+// Attempts of every student, grouped by exam in submission order. Built from
+// the journal at startup and updated as each submission is committed, so the
+// dashboard lists attempts and a scheduled exam start is checked without
+// reading the result files.
+class AttemptIndex {
+public:
+    static void add(const Submission& submission, uint64_t lsn);
+    static map<string, vector<AttemptRef>> forStudent(const string& studentId);
+    static bool claim(const string& studentId, const string& examName);
+
+private:
+    static const int SHARDS = 64;
+
+    struct Student {
+        unordered_map<uint32_t, vector<AttemptRef>> exams;  // exam ID -> committed attempts
+        unordered_set<uint32_t> started;                    // scheduled exams started, maybe not submitted yet
+    };
+
+    // Student IDs are dense: shard = ID % SHARDS, slot = ID / SHARDS
+    struct Shard {
+        Shard() { pthread_rwlock_init(&lock, nullptr); }
+        pthread_rwlock_t lock;
+        vector<Student> students;
+    };
+
+    static Shard shards[SHARDS];
+
+    static Student& studentFor(Shard& shard, uint32_t studentId);
+};
+
+#endif
@@ -9,16 +9,18 @@
 #include <sstream>   
 #include <functional> 
 
+#include "user_store.h"
+#include "password_hasher.h"
+#include "name_dictionary.h"
+
 using namespace std;
 
 class AuthManager {
 private:
-    static unordered_map<string, string> student_db;
-    static unordered_map<string, string> instructor_db;
+    static UserStore student_db;
+    static UserStore instructor_db;
 
-    static string hash_password(const string& password);
-    static void load_users(const string& filename, unordered_map<string, string>& user_db);
-    static bool save_user(const string& filename, const string& username, const string& password);
+    static UserStore* store_for(const string& user_type);
 
 public:
     AuthManager();
@@ -0,0 +1,82 @@
+#include "config.h"
+
+// Defaults used when the config file is missing or a key is absent
+int ServerConfig::workerThreads = 0;
+int ServerConfig::workerQueueCapacity = 1024;
+string ServerConfig::overloadPolicy = "queue";
+int ServerConfig::retryAfterMs = 200;
+size_t ServerConfig::maxPayloadBytes = 16 * 1024 * 1024;
+string ServerConfig::journalPath = "../data/submissions.journal";
+int ServerConfig::journalMaxBatch = 512;
+int ServerConfig::kdfLogN = 14;
+int ServerConfig::kdfR = 8;
+int ServerConfig::kdfP = 1;
+int ServerConfig::hashThreads = 0;
+int ServerConfig::hashQueueCapacity = 256;
+string ServerConfig::hashOverloadPolicy = "busy";
+int ServerConfig::paperCacheMb = 64;
+int ServerConfig::predistributeMinutes = 30;
+int ServerConfig::sessionTtlSeconds = 900;
+int ServerConfig::leaderboardTop = 10;
+int ServerConfig::metricsPort = 9100;
+
+/**
+ * Loads "key = value" settings from a file. Blank lines and lines starting
+ * with '#' are ignored; unknown keys are reported and skipped.
+ *
+ * @param filename Path to the configuration file.
+ */
+void ServerConfig::load(const string& filename) {
+    ifstream file(filename);
+    if (!file) {
+        cout << "[+] No " << filename << " found, using default settings" << endl;
+        return;
+    }
+
+    string line;
+    while (getline(file, line)) {
+        // Strip comments and surrounding whitespace
+        size_t hash = line.find('#');
+        if (hash != string::npos) line = line.substr(0, hash);
+
+        size_t eq = line.find('=');
+        if (eq == string::npos) continue;
+
+        string key = line.substr(0, eq), value = line.substr(eq + 1);
+        key.erase(0, key.find_first_not_of(" \t"));
+        key.erase(key.find_last_not_of(" \t\r") + 1);
+        value.erase(0, value.find_first_not_of(" \t"));
+        value.erase(value.find_last_not_of(" \t\r") + 1);
+        if (key.empty()) continue;
+
+        apply(key, value);
+    }
+}
+
+/**
+ * Applies a single setting.
+ *
+ * @param key Setting name.
+ * @param value Setting value as text.
+ */
+void ServerConfig::apply(const string& key, const string& value) {
+    if (key == "worker_threads") workerThreads = atoi(value.c_str());
+    else if (key == "worker_queue_capacity") workerQueueCapacity = atoi(value.c_str());
+    else if (key == "overload_policy") overloadPolicy = value;
+    else if (key == "retry_after_ms") retryAfterMs = atoi(value.c_str());
+    else if (key == "max_payload_bytes") maxPayloadBytes = strtoull(value.c_str(), nullptr, 10);
+    else if (key == "journal_path") journalPath = value;
+    else if (key == "journal_max_batch") journalMaxBatch = atoi(value.c_str());
+    else if (key == "kdf_log_n") kdfLogN = atoi(value.c_str());
+    else if (key == "kdf_r") kdfR = atoi(value.c_str());
+    else if (key == "kdf_p") kdfP = atoi(value.c_str());
+    else if (key == "hash_threads") hashThreads = atoi(value.c_str());
+    else if (key == "hash_queue_capacity") hashQueueCapacity = atoi(value.c_str());
+    else if (key == "hash_overload_policy") hashOverloadPolicy = value;
+    else if (key == "paper_cache_mb") paperCacheMb = atoi(value.c_str());
+    else if (key == "predistribute_minutes") predistributeMinutes = atoi(value.c_str());
+    else if (key == "session_ttl_seconds") sessionTtlSeconds = atoi(value.c_str());
+    else if (key == "leaderboard_top") leaderboardTop = atoi(value.c_str());
+    else if (key == "metrics_port") metricsPort = atoi(value.c_str());
+    else cerr << "Warning: unknown config key '" << key << "'" << endl;
+}
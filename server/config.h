@@ -0,0 +1,55 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+using namespace std;
+
+// Server tunables, read once at startup from ../data/server.conf (key = value)
+class ServerConfig {
+public:
+    // Worker pool
+    static int workerThreads;           // 0 = one per online core
+    static int workerQueueCapacity;
+    static string overloadPolicy;       // "queue", "shed" or "busy"
+    static int retryAfterMs;            // hint sent with the "busy" reply
+
+    // Protocol
+    static size_t maxPayloadBytes;      // largest frame payload accepted from a client
+
+    // Submission journal
+    static string journalPath;
+    static int journalMaxBatch;         // most submissions written by one group commit
+
+    // Password hashing (scrypt, N = 2^kdfLogN) on its own bounded pool
+    static int kdfLogN;
+    static int kdfR;
+    static int kdfP;
+    static int hashThreads;             // 0 = one per online core
+    static int hashQueueCapacity;
+    static string hashOverloadPolicy;
+
+    // Exam papers
+    static int paperCacheMb;            // memory for compressed papers
+    static int predistributeMinutes;    // sealed scheduled papers are handed out this early
+
+    // Reconnecting clients
+    static int sessionTtlSeconds;       // how long an idle session token stays valid
+
+    // Analysis
+    static int leaderboardTop;          // leaderboard rows shown to a student
+
+    // Metrics
+    static int metricsPort;             // local Prometheus port, 0 = SIGUSR1 dump only
+
+    static void load(const string& filename);
+
+private:
+    static void apply(const string& key, const string& value);
+};
+
+#endif
@@ -0,0 +1,130 @@
+#include "exam_catalog.h"
+#include <sstream>
+#include <iomanip>
+#include <atomic>
+
+shared_ptr<const CatalogSnapshot> ExamCatalog::current = make_shared<CatalogSnapshot>();
+pthread_mutex_t ExamCatalog::writerMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Fills the derived fields (schedule flag, parsed start time, list line)
+ * once the metadata fields are set.
+ */
+void ExamEntry::finalize() {
+    scheduled = (type == "g" || type == "G");
+
+    start = 0;
+    if (scheduled) {
+        tm tm = {};
+        istringstream ss(startTime);
+        ss >> get_time(&tm, "%Y-%m-%d %H:%M:%S");
+        if (!ss.fail()) {
+            tm.tm_isdst = -1;
+            start = mktime(&tm);
+        }
+    }
+
+    // Same layout the metadata file produced when its lines were joined with " | "
+    listing = "Exam Name: " + name + " | Exam type: " + type + " | Start Time: " + startTime +
+              " | Duration (minutes): " + to_string(duration) + " | Total Questions: " +
+              to_string(totalQuestions) + " | Instructor: " + instructor + " | Paper: " + paperHash + " |";
+}
+
+/**
+ * Looks up an exam by name.
+ *
+ * @return The exam, or nullptr if there is none with that name.
+ */
+shared_ptr<const ExamEntry> CatalogSnapshot::find(const string& name) const {
+    auto it = nameIndex.find(name);
+    return it == nameIndex.end() ? nullptr : exams[it->second];
+}
+
+/**
+ * Exams uploaded by an instructor, in upload order.
+ */
+vector<shared_ptr<const ExamEntry>> CatalogSnapshot::byInstructor(const string& instructor) const {
+    vector<shared_ptr<const ExamEntry>> result;
+    uint32_t id;
+    if (!NameDictionary::find(NameKind::INSTRUCTOR, instructor, id)) return result;
+    auto it = instructorIndex.find(id);
+    if (it == instructorIndex.end()) return result;
+    for (size_t index : it->second) result.push_back(exams[index]);
+    return result;
+}
+
+/**
+ * Scheduled exams whose start time lies in [from, to], earliest first.
+ */
+vector<shared_ptr<const ExamEntry>> CatalogSnapshot::startingBetween(time_t from, time_t to) const {
+    vector<shared_ptr<const ExamEntry>> result;
+    for (auto it = startIndex.lower_bound(from); it != startIndex.end() && it->first <= to; ++it)
+        result.push_back(exams[it->second]);
+    return result;
+}
+
+/**
+ * Adds an exam to an unpublished snapshot and its indexes.
+ */
+void ExamCatalog::add(CatalogSnapshot& snapshot, const ExamEntry& entry) {
+    size_t index = snapshot.exams.size();
+    snapshot.exams.push_back(make_shared<const ExamEntry>(entry));
+    snapshot.nameIndex[entry.name] = index;
+    NameDictionary::intern(NameKind::EXAM, entry.name);
+    snapshot.instructorIndex[NameDictionary::intern(NameKind::INSTRUCTOR, entry.instructor)].push_back(index);
+    if (entry.scheduled) snapshot.startIndex.emplace(entry.start, index);
+}
+
+/**
+ * Replaces the catalog with the exams read at startup.
+ *
+ * @param entries Exams in exam_list.txt order.
+ */
+void ExamCatalog::load(const vector<ExamEntry>& entries) {
+    auto next = make_shared<CatalogSnapshot>();
+    for (const ExamEntry& entry : entries) {
+        if (next->nameIndex.count(entry.name)) continue;
+        add(*next, entry);
+    }
+
+    pthread_mutex_lock(&writerMutex);
+    atomic_store(&current, shared_ptr<const CatalogSnapshot>(move(next)));
+    pthread_mutex_unlock(&writerMutex);
+}
+
+/**
+ * Adds a newly uploaded exam. The new snapshot shares every existing entry
+ * with the old one; only the index containers are copied.
+ *
+ * @param entry Exam to add.
+ * @return False if an exam with the same name already exists.
+ */
+bool ExamCatalog::insert(const ExamEntry& entry) {
+    pthread_mutex_lock(&writerMutex);
+    shared_ptr<const CatalogSnapshot> old = atomic_load(&current);
+    if (old->nameIndex.count(entry.name)) {
+        pthread_mutex_unlock(&writerMutex);
+        return false;
+    }
+
+    auto next = make_shared<CatalogSnapshot>(*old);
+    add(*next, entry);
+    atomic_store(&current, shared_ptr<const CatalogSnapshot>(move(next)));
+    pthread_mutex_unlock(&writerMutex);
+    return true;
+}
+
+/**
+ * Returns the current snapshot; it stays valid (and unchanged) for as long as
+ * the caller holds it.
+ */
+shared_ptr<const CatalogSnapshot> ExamCatalog::snapshot() {
+    return atomic_load(&current);
+}
+
+/**
+ * Looks up an exam by name in the current snapshot.
+ */
+shared_ptr<const ExamEntry> ExamCatalog::find(const string& name) {
+    return snapshot()->find(name);
+}
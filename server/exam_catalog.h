@@ -0,0 +1,69 @@
+#ifndef EXAM_CATALOG_H
+#define EXAM_CATALOG_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <ctime>
+#include <pthread.h>
+
+#include "name_dictionary.h"
+
+using namespace std;
+
+// Typed metadata of one uploaded exam
+struct ExamEntry {
+    string name;
+    string type;            // as uploaded: "g" scheduled, anything else practice
+    string startTime;       // "YYYY-MM-DD HH:MM:SS", empty for practice tests
+    int duration;           // minutes
+    int totalQuestions;
+    string instructor;
+    string paperHash;       // ContentHash of the question paper, empty if it has no image
+
+    bool scheduled;         // type is "g" / "G"
+    time_t start;           // parsed startTime, 0 for practice tests
+    string listing;         // line shown in the student exam list (client parses it)
+
+    void finalize();
+};
+
+// Immutable state of the catalog. Readers hold one for as long as they need a
+// consistent view; writers never modify a published snapshot.
+class CatalogSnapshot {
+public:
+    size_t size() const { return exams.size(); }
+    const ExamEntry& at(size_t index) const { return *exams[index]; }
+    shared_ptr<const ExamEntry> find(const string& name) const;
+    vector<shared_ptr<const ExamEntry>> byInstructor(const string& instructor) const;
+    vector<shared_ptr<const ExamEntry>> startingBetween(time_t from, time_t to) const;
+
+private:
+    friend class ExamCatalog;
+
+    vector<shared_ptr<const ExamEntry>> exams;              // upload order; exam number = index + 1
+    unordered_map<string, size_t> nameIndex;                // name -> position in exams
+    unordered_map<uint32_t, vector<size_t>> instructorIndex; // instructor ID -> positions, upload order
+    multimap<time_t, size_t> startIndex;                    // scheduled exams by start time
+};
+
+// Process-wide exam catalog with copy-on-write snapshots: readers take the
+// current snapshot without touching the writer mutex, an upload builds the
+// next snapshot from the previous one and publishes it atomically.
+class ExamCatalog {
+public:
+    static void load(const vector<ExamEntry>& entries);
+    static bool insert(const ExamEntry& entry);
+    static shared_ptr<const CatalogSnapshot> snapshot();
+    static shared_ptr<const ExamEntry> find(const string& name);
+
+private:
+    static shared_ptr<const CatalogSnapshot> current;
+    static pthread_mutex_t writerMutex;
+
+    static void add(CatalogSnapshot& snapshot, const ExamEntry& entry);
+};
+
+#endif
@@ -0,0 +1,200 @@
+#include "exam_image.h"
+
+#define IMAGE_VERSION 2
+
+map<string, shared_ptr<const ExamImage>> ExamImage::cache;
+pthread_mutex_t ExamImage::cacheMutex = PTHREAD_MUTEX_INITIALIZER;
+
+ExamImage::ExamImage(const char* base, size_t length, int fd)
+    : base(base), length(length), fd(fd) {
+    header = reinterpret_cast<const ExamImageHeader*>(base);
+    table = reinterpret_cast<const uint32_t*>(base + header->tableOffset);
+    key = reinterpret_cast<const uint8_t*>(base + header->keyOffset);
+    hash = ContentHash::of(paper());
+}
+
+ExamImage::~ExamImage() {
+    munmap(const_cast<char*>(base), length);
+    close(fd);
+}
+
+/**
+ * Path of the compiled image for an exam.
+ */
+string ExamImage::imagePath(const string& examName) {
+    return "../data/exams/image_" + examName + ".bin";
+}
+
+/**
+ * Compiles questions and answer key into an image file. The file is written
+ * under a temporary name and renamed, so readers never map a partial image.
+ *
+ * @param path Destination file.
+ * @param questions Question blocks, each already formatted as sent in the paper.
+ * @param answers Correct option per question (0 = A ... 3 = D).
+ * @return True if the image was written.
+ */
+bool ExamImage::write(const string& path, const vector<string>& questions, const vector<int>& answers) {
+    uint32_t count = questions.size();
+
+    ExamImageHeader h{};
+    memcpy(h.magic, "EXIM", 4);
+    h.version = IMAGE_VERSION;
+    h.questionCount = count;
+    h.tableOffset = sizeof(ExamImageHeader);
+    h.frameOffset = h.tableOffset + (count + 1) * sizeof(uint32_t);
+    h.blobOffset = h.frameOffset + Protocol::HEADER_SIZE;
+
+    vector<uint32_t> offsets;
+    uint32_t offset = h.blobOffset;
+    for (const string& q : questions) {
+        offsets.push_back(offset);
+        offset += q.size();
+    }
+    offsets.push_back(offset);
+    h.keyOffset = offset;
+
+    // Four answers per byte, question i in bits 2*(i%4)..2*(i%4)+1
+    vector<uint8_t> packed((count + 3) / 4, 0);
+    for (uint32_t i = 0; i < count; ++i) packed[i / 4] |= (answers[i] & 3) << (2 * (i % 4));
+    h.fileSize = h.keyOffset + packed.size();
+
+    string tmp = path + ".tmp";
+    ofstream out(tmp, ios::binary | ios::trunc);
+    if (!out) {
+        cerr << "Error: Unable to create exam image " << tmp << "\n";
+        return false;
+    }
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    out.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint32_t));
+    out << Protocol::encodeHeader(MsgType::PAPER, h.keyOffset - h.blobOffset);
+    for (const string& q : questions) out.write(q.data(), q.size());
+    out.write(reinterpret_cast<const char*>(packed.data()), packed.size());
+    out.close();
+
+    if (!out || rename(tmp.c_str(), path.c_str()) != 0) {
+        cerr << "Error: Unable to write exam image " << path << "\n";
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Maps an image file and checks that its header and offsets are consistent.
+ *
+ * @param path Image file.
+ * @return The mapped image, or nullptr if the file is missing or invalid.
+ */
+shared_ptr<const ExamImage> ExamImage::load(const string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) return nullptr;
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size < (off_t)sizeof(ExamImageHeader)) {
+        close(fd);
+        return nullptr;
+    }
+
+    void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        close(fd);
+        return nullptr;
+    }
+
+    const char* base = static_cast<const char*>(addr);
+    const ExamImageHeader* h = reinterpret_cast<const ExamImageHeader*>(base);
+    size_t size = st.st_size;
+
+    // Images from an older format are recompiled from the exam's text files
+    if (memcmp(h->magic, "EXIM", 4) == 0 && h->version != IMAGE_VERSION) {
+        munmap(addr, size);
+        close(fd);
+        return nullptr;
+    }
+
+    bool valid = memcmp(h->magic, "EXIM", 4) == 0 && h->fileSize == size &&
+                 h->tableOffset == sizeof(ExamImageHeader) &&
+                 h->frameOffset == h->tableOffset + (uint64_t(h->questionCount) + 1) * sizeof(uint32_t) &&
+                 h->blobOffset == h->frameOffset + Protocol::HEADER_SIZE &&
+                 h->keyOffset <= size && size - h->keyOffset == (h->questionCount + 3) / 4;
+    if (valid) {
+        const uint32_t* offsets = reinterpret_cast<const uint32_t*>(base + h->tableOffset);
+        valid = offsets[0] == h->blobOffset && offsets[h->questionCount] == h->keyOffset;
+        for (uint32_t i = 0; valid && i < h->questionCount; ++i) valid = offsets[i] <= offsets[i + 1];
+        valid = valid && string(base + h->frameOffset, Protocol::HEADER_SIZE) ==
+                         Protocol::encodeHeader(MsgType::PAPER, h->keyOffset - h->blobOffset);
+    }
+    if (!valid) {
+        cerr << "Error: Corrupt exam image " << path << "\n";
+        munmap(addr, size);
+        close(fd);
+        return nullptr;
+    }
+
+    return shared_ptr<const ExamImage>(new ExamImage(base, size, fd));
+}
+
+/**
+ * Returns the image of an exam, mapping it on first use.
+ *
+ * @param examName Exam name.
+ * @return The shared image, or nullptr if the exam has no valid image.
+ */
+shared_ptr<const ExamImage> ExamImage::get(const string& examName) {
+    pthread_mutex_lock(&cacheMutex);
+    auto it = cache.find(examName);
+    if (it != cache.end()) {
+        shared_ptr<const ExamImage> image = it->second;
+        pthread_mutex_unlock(&cacheMutex);
+        return image;
+    }
+    pthread_mutex_unlock(&cacheMutex);
+
+    // Map outside the lock; if two threads race, the first one cached wins
+    shared_ptr<const ExamImage> image = load(imagePath(examName));
+    if (!image) return nullptr;
+
+    pthread_mutex_lock(&cacheMutex);
+    auto inserted = cache.emplace(examName, image);
+    image = inserted.first->second;
+    pthread_mutex_unlock(&cacheMutex);
+    return image;
+}
+
+/**
+ * The full question paper: every question blob, back to back.
+ */
+string_view ExamImage::paper() const {
+    return string_view(base + table[0], table[header->questionCount] - table[0]);
+}
+
+/**
+ * Size of the encoded PAPER frame (header and paper) at paperFrameOffset().
+ */
+size_t ExamImage::paperFrameLength() const {
+    return Protocol::HEADER_SIZE + table[header->questionCount] - table[0];
+}
+
+/**
+ * One question blob (question text, options and trailing blank line).
+ */
+string_view ExamImage::question(int index) const {
+    return string_view(base + table[index], table[index + 1] - table[index]);
+}
+
+/**
+ * Correct option of a question (0 = A ... 3 = D).
+ */
+int ExamImage::answer(int index) const {
+    return (key[index / 4] >> (2 * (index % 4))) & 3;
+}
+
+/**
+ * Unpacks the whole answer key.
+ */
+vector<int8_t> ExamImage::answerKey() const {
+    vector<int8_t> answers(header->questionCount);
+    for (uint32_t i = 0; i < header->questionCount; ++i) answers[i] = answer(i);
+    return answers;
+}
@@ -0,0 +1,77 @@
+#ifndef EXAM_IMAGE_H
+#define EXAM_IMAGE_H
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "protocol.h"
+#include "content_hash.h"
+
+using namespace std;
+
+// Fixed header at the start of an exam image. All integers are native
+// (little-endian) uint32; offsets are from the start of the file.
+struct ExamImageHeader {
+    char magic[4];              // "EXIM"
+    uint32_t version;
+    uint32_t questionCount;
+    uint32_t tableOffset;       // questionCount + 1 offsets into the file
+    uint32_t blobOffset;        // first question blob; blobs are contiguous
+    uint32_t keyOffset;         // packed answer key, 2 bits per question
+    uint32_t fileSize;
+    uint32_t frameOffset;       // PAPER frame header, right before the first blob
+};
+
+// Compiled, read-only form of an uploaded exam, memory-mapped once and shared.
+// Question i is [table[i], table[i+1]) and is stored exactly as it appears in
+// the paper sent to clients, so the whole paper is one contiguous range. The
+// encoded PAPER frame header is stored just before it, which makes the frame
+// sent to students a single file range that can go out with sendfile().
+class ExamImage {
+public:
+    ~ExamImage();
+
+    static bool write(const string& path, const vector<string>& questions, const vector<int>& answers);
+    static shared_ptr<const ExamImage> get(const string& examName);
+    static string imagePath(const string& examName);
+
+    int questionCount() const { return header->questionCount; }
+    string_view paper() const;
+    const string& paperHash() const { return hash; }
+    int fileDescriptor() const { return fd; }
+    off_t paperFrameOffset() const { return header->frameOffset; }
+    size_t paperFrameLength() const;
+    string_view question(int index) const;
+    int answer(int index) const;
+    vector<int8_t> answerKey() const;
+
+private:
+    const char* base;
+    size_t length;
+    int fd;                     // kept open for sendfile()
+    string hash;                // ContentHash of the paper
+    const ExamImageHeader* header;
+    const uint32_t* table;
+    const uint8_t* key;
+
+    ExamImage(const char* base, size_t length, int fd);
+    static shared_ptr<const ExamImage> load(const string& path);
+
+    // Mapped images by exam name; uploaded exams never change, so entries stay valid
+    static map<string, shared_ptr<const ExamImage>> cache;
+    static pthread_mutex_t cacheMutex;
+};
+
+#endif
@@ -1,8 +1,5 @@
 #include "exam_manager.h"
 
-// Mutex to protect concurrent access to exam_list.txt when appending new exams
-pthread_mutex_t file_mutex4 = PTHREAD_MUTEX_INITIALIZER;
-
 /**
  * Parses an exam file and stores its questions, answers, and metadata.
  * 
@@ -67,6 +64,24 @@ bool ExamManager::parse_exam(const string& exam_type, const string& input_file,
         return false;
     }
 
+    // Every question needs a correct option between A and D for the packed answer key
+    vector<int> answerKey;
+    for (string a : answers) {
+        a.erase(remove_if(a.begin(), a.end(), ::isspace), a.end());
+        if (a.empty() || toupper(a[0]) < 'A' || toupper(a[0]) > 'D') {
+            cout << "[-] Error: Question " << answerKey.size() + 1 << " has no valid answer (A-D).\n";
+            return false;
+        }
+        answerKey.push_back(toupper(a[0]) - 'A');
+    }
+
+    // Compile the binary image first; the text files below are kept for reference
+    vector<string> blobs;
+    for (const string &q : questions) blobs.push_back(q + "\n\n");
+    if (!ExamImage::write(ExamImage::imagePath(exam_name), blobs, answerKey)) {
+        return false;
+    }
+
     // Define file paths for metadata, questions, and answers
     string metadataFile = "../data/exams/metadata_" + exam_name + ".txt";
     string questionsFile = "../data/exams/questions_" + exam_name + ".txt";
@@ -98,12 +113,16 @@ bool ExamManager::parse_exam(const string& exam_type, const string& input_file,
     }
     answerFile.close();
 
-    // Append exam name and metadata file path to exam list file, thread-safe using mutex
-    pthread_mutex_lock(&file_mutex4);
-    ofstream examList("../data/exams/exam_list.txt", ios::app);
-    examList << exam_name << "|" << metadataFile << "\n";
-    examList.close();
-    pthread_mutex_unlock(&file_mutex4);
+    // Append exam name and metadata file path to exam list file; one O_APPEND
+    // write per line keeps concurrent uploads from interleaving
+    string listEntry = exam_name + "|" + metadataFile + "\n";
+    int listFd = open("../data/exams/exam_list.txt", O_WRONLY | O_APPEND | O_CREAT, 0644);
+    bool listed = listFd != -1 && write(listFd, listEntry.data(), listEntry.size()) == (ssize_t)listEntry.size();
+    if (listFd != -1) close(listFd);
+    if (!listed) {
+        cerr << "Error: Unable to add " << exam_name << " to the exam list\n";
+        return false;
+    }
 
     cout << "[+] Exam successfully parsed and stored!\n";
     return true;
@@ -113,14 +132,14 @@ bool ExamManager::parse_exam(const string& exam_type, const string& input_file,
  * Loads metadata for all exams listed in the given exam list file.
  * 
  * @param exam_list_file Path to the file containing exam names and metadata paths.
- * @return Vector of metadata strings for each exam, excluding questions and answers file info.
+ * @return Typed metadata of each exam, in list order.
  */
-vector<string> ExamManager::load_exam_metadata(const string& exam_list_file) {
-    vector<string> examMetadata;
+vector<ExamEntry> ExamManager::load_exam_entries(const string& exam_list_file) {
+    vector<ExamEntry> entries;
     ifstream examList(exam_list_file);
     if (!examList) {
         cerr << "Error: Unable to open " << exam_list_file << "\n";
-        return examMetadata;
+        return entries;
     }
 
     string line;
@@ -130,28 +149,52 @@ vector<string> ExamManager::load_exam_metadata(const string& exam_list_file) {
 
         // Parse exam name and metadata file path from each line
         if (getline(iss, examName, '|') && getline(iss, metadataPath)) {
-            ifstream metadataFile(metadataPath);
-            if (!metadataFile) {
-                cerr << "Error: Unable to open metadata file " << metadataPath << "\n";
-                continue;
-            }
-
-            ostringstream metadata;
-            string metaLine;
-            // Read metadata lines, stop before questions/answers file info
-            while (getline(metadataFile, metaLine)) {
-                if (metaLine.find("Questions File:") != string::npos || 
-                    metaLine.find("Answers File:") != string::npos) {
-                    break;
-                }
-                metadata << metaLine << "\n";
-            }
-            metadataFile.close();
-            examMetadata.push_back(metadata.str());
+            ExamEntry entry;
+            if (load_exam_entry(metadataPath, entry)) entries.push_back(entry);
         }
     }
     examList.close();
-    return examMetadata;
+    return entries;
+}
+
+/**
+ * Reads one exam's metadata file into a typed entry.
+ * 
+ * @param metadataPath Path to the exam metadata file.
+ * @param entry Receives the exam details.
+ * @return False if the file cannot be opened.
+ */
+bool ExamManager::load_exam_entry(const string& metadataPath, ExamEntry& entry) {
+    ifstream metadataFile(metadataPath);
+    if (!metadataFile) {
+        cerr << "Error: Unable to open metadata file " << metadataPath << "\n";
+        return false;
+    }
+
+    entry = ExamEntry();
+    entry.duration = 0;
+    entry.totalQuestions = 0;
+
+    string line;
+    while (getline(metadataFile, line)) {
+        size_t colon = line.find(':');
+        if (colon == string::npos) continue;
+        string key = line.substr(0, colon);
+        string value = line.size() > colon + 1 ? line.substr(colon + 2) : "";
+
+        if (key == "Exam Name") entry.name = value;
+        else if (key == "Exam type") entry.type = value;
+        else if (key == "Start Time") entry.startTime = value;
+        else if (key == "Duration (minutes)") entry.duration = atoi(value.c_str());
+        else if (key == "Total Questions") entry.totalQuestions = atoi(value.c_str());
+        else if (key == "Instructor") entry.instructor = value;
+    }
+
+    // Clients cache the paper under this hash
+    shared_ptr<const ExamImage> image = ExamImage::get(entry.name);
+    if (image) entry.paperHash = image->paperHash();
+    entry.finalize();
+    return !entry.name.empty();
 }
 
 /**
@@ -205,46 +248,75 @@ string ExamManager::getQuestionsFilePath(const string& metadataPath) {
 }
 
 /**
- * Sends the questions of a specified exam over a socket.
+ * Builds the question paper payload of a specified exam for sending to a client.
+ * The paper is read straight from the exam's memory-mapped image.
  * 
- * @param sock The socket descriptor to send data over.
  * @param examName The name of the exam whose questions are to be sent.
+ * @param payload Receives the questions text, or the reason the exam cannot be loaded.
+ * @return True if payload holds the question paper, false if it holds an error.
  */
-void ExamManager::sendExamQuestions(int sock, const string& examName) {
-    // Retrieve the path to the metadata file for the exam
-    string metadataPath = getMetadataFilePath(examName);
-    if (metadataPath.empty()) {
-        string errorMsg = "Error: Exam not found.\n";
-        send(sock, errorMsg.c_str(), errorMsg.size(), 0);
-        return;
+bool ExamManager::getExamQuestions(const string& examName, string& payload) {
+    shared_ptr<const ExamImage> image = ExamImage::get(examName);
+    if (!image) {
+        payload = "Error: Exam not found.\n";
+        return false;
     }
 
-    // Retrieve the questions file path from metadata
-    string questionFilePath = getQuestionsFilePath(metadataPath);
-    if (questionFilePath.empty()) {
-        string errorMsg = "Error: No questions file found.\n";
-        send(sock, errorMsg.c_str(), errorMsg.size(), 0);
-        return;
-    }
+    payload.assign(image->paper());
+    return true;
+}
 
-    ifstream questionFile(questionFilePath);
-    if (!questionFile) {
-        string errorMsg = "Error: Unable to open questions file.\n";
-        send(sock, errorMsg.c_str(), errorMsg.size(), 0);
-        return;
+/**
+ * Compiles the image of an exam uploaded before images existed, from its
+ * questions_ and answers_ text files.
+ *
+ * @param exam_name Exam to compile.
+ * @return True if the image was written.
+ */
+bool ExamManager::compile_image(const string& exam_name) {
+    ifstream questionFile("../data/exams/questions_" + exam_name + ".txt");
+    ifstream answerFile("../data/exams/answers_" + exam_name + ".txt");
+    if (!questionFile || !answerFile) {
+        cerr << "Error: Unable to open question/answer files of " << exam_name << "\n";
+        return false;
     }
 
-    // Read entire questions file content
-    string questionData, line;
+    // Each question block starts with a "Q:" line and runs until the next one
+    vector<string> blobs;
+    string line;
     while (getline(questionFile, line)) {
-        questionData += line + "\n";
+        if (line.rfind("Q:", 0) == 0 || blobs.empty()) blobs.push_back("");
+        blobs.back() += line + "\n";
     }
-    
-    // Handle empty questions file case
-    if (questionData.empty()) {
-        questionData = "Error: Questions file is empty.\n";
+
+    vector<int> answerKey;
+    while (getline(answerFile, line)) {
+        line.erase(remove_if(line.begin(), line.end(), ::isspace), line.end());
+        if (line.empty()) continue;
+        int option = toupper(line[0]) - 'A';
+        answerKey.push_back(option >= 0 && option <= 3 ? option : 0);
+    }
+
+    if (blobs.empty() || blobs.size() != answerKey.size()) {
+        cerr << "Error: " << exam_name << " has " << blobs.size() << " questions but "
+             << answerKey.size() << " answers, image not built\n";
+        return false;
+    }
+    return ExamImage::write(ExamImage::imagePath(exam_name), blobs, answerKey);
+}
+
+/**
+ * Builds images for every listed exam that does not have a current one yet
+ * (missing, or written in an older image format).
+ *
+ * @param exam_list_file Path to the file containing exam names and metadata paths.
+ */
+void ExamManager::compile_missing_images(const string& exam_list_file) {
+    ifstream examList(exam_list_file);
+    string line;
+    while (getline(examList, line)) {
+        string examName = line.substr(0, line.find('|'));
+        if (examName.empty() || ExamImage::get(examName)) continue;
+        if (compile_image(examName)) cout << "[+] Compiled exam image for " << examName << "\n";
     }
-    
-    // Send questions data to client via socket
-    send(sock, questionData.c_str(), questionData.size(), 0);
 }
@@ -10,17 +10,24 @@
 #include <unistd.h>
 #include <sys/stat.h>
 #include <fstream>
+#include <algorithm>
 #include<pthread.h>
 
+#include "exam_image.h"
+#include "exam_catalog.h"
+
 using namespace std;
 
 class ExamManager {
 public:
     bool parse_exam(const string& exam_type, const string& input_file, const string& exam_name, const string& instructor, int duration, const string& start_time);
-    vector<string> load_exam_metadata(const string& exam_list_file);
+    vector<ExamEntry> load_exam_entries(const string& exam_list_file);
+    bool load_exam_entry(const string& metadataPath, ExamEntry& entry);
     string getMetadataFilePath(const string& examName);
     string getQuestionsFilePath(const string& metadataPath) ;
-    void sendExamQuestions(int sock, const string& examName);
+    bool getExamQuestions(const string& examName, string& payload);
+    bool compile_image(const string& exam_name);
+    void compile_missing_images(const string& exam_list_file);
 };
 
 #endif
@@ -0,0 +1,86 @@
+#include "exam_seal.h"
+#include "metrics.h"
+
+map<string, string> ExamSeal::keys;
+map<string, shared_ptr<const string>> ExamSeal::frames;
+pthread_mutex_t ExamSeal::mutex = PTHREAD_MUTEX_INITIALIZER;
+
+string ExamSeal::keyPath(const string& examName) {
+    return "../data/exams/key_" + examName + ".bin";
+}
+
+/**
+ * Returns the key of an exam, creating it on first use.
+ *
+ * @param examName Exam name.
+ * @param key Receives Seal::KEY_SIZE bytes.
+ * @return False if the key could not be read or created.
+ */
+bool ExamSeal::key(const string& examName, string& key) {
+    Metrics::lock(&mutex, LockId::EXAM_SEAL);
+    auto it = keys.find(examName);
+    bool found = it != keys.end();
+    if (found) key = it->second;
+    else if ((found = loadOrCreateKey(examName, key))) keys[examName] = key;
+    pthread_mutex_unlock(&mutex);
+    return found;
+}
+
+/**
+ * Reads an exam's key file, or creates it (readable by the server only).
+ * Caller holds the mutex.
+ */
+bool ExamSeal::loadOrCreateKey(const string& examName, string& key) {
+    string path = keyPath(examName);
+    ifstream in(path, ios::binary);
+    if (in) {
+        key.assign(Seal::KEY_SIZE, '\0');
+        in.read(&key[0], Seal::KEY_SIZE);
+        if (in.gcount() == (streamsize)Seal::KEY_SIZE) return true;
+        cerr << "Error: Corrupt exam key " << path << endl;
+        return false;
+    }
+
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0600);
+    bool written = fd != -1 && Seal::newKey(key) &&
+                   write(fd, key.data(), key.size()) == (ssize_t)key.size() && fsync(fd) == 0;
+    if (fd != -1) close(fd);
+    if (!written) {
+        cerr << "Error: Unable to create exam key " << path << endl;
+        unlink(path.c_str());
+    }
+    return written;
+}
+
+/**
+ * Returns the encoded PAPER_SEALED frame of an exam, building it on first use:
+ * the paper is compressed, then sealed with the exam's key.
+ *
+ * @param examName Exam name.
+ * @return The frame, or nullptr if the exam has no image or no key.
+ */
+shared_ptr<const string> ExamSeal::sealedFrame(const string& examName) {
+    Metrics::lock(&mutex, LockId::EXAM_SEAL);
+    auto it = frames.find(examName);
+    if (it != frames.end()) {
+        shared_ptr<const string> frame = it->second;
+        pthread_mutex_unlock(&mutex);
+        return frame;
+    }
+    pthread_mutex_unlock(&mutex);
+
+    // Build outside the lock; if two threads race, the first one cached wins
+    shared_ptr<const ExamImage> image = ExamImage::get(examName);
+    string examKey, compressed, sealed;
+    if (!image || !key(examName, examKey) || !Compression::deflate(string(image->paper()), compressed) ||
+        !Seal::seal(examKey, compressed, sealed)) {
+        return nullptr;
+    }
+    auto frame = make_shared<string>(Protocol::encodeHeader(MsgType::PAPER_SEALED, sealed.size()));
+    *frame += sealed;
+
+    Metrics::lock(&mutex, LockId::EXAM_SEAL);
+    shared_ptr<const string> cached = frames.emplace(examName, frame).first->second;
+    pthread_mutex_unlock(&mutex);
+    return cached;
+}
@@ -0,0 +1,38 @@
+#ifndef EXAM_SEAL_H
+#define EXAM_SEAL_H
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <map>
+#include <memory>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "exam_image.h"
+#include "compression.h"
+#include "protocol.h"
+#include "seal.h"
+
+using namespace std;
+
+// Sealed papers of scheduled exams. Each exam gets a random key, kept in
+// ../data/exams/key_<exam>.bin; its paper is compressed and sealed once, and
+// the same PAPER_SEALED frame can be handed out ahead of the start. At the
+// start students only fetch the key.
+class ExamSeal {
+public:
+    static bool key(const string& examName, string& key);
+    static shared_ptr<const string> sealedFrame(const string& examName);
+
+private:
+    static map<string, string> keys;
+    static map<string, shared_ptr<const string>> frames;
+    static pthread_mutex_t mutex;
+
+    static string keyPath(const string& examName);
+    static bool loadOrCreateKey(const string& examName, string& key);
+};
+
+#endif
@@ -0,0 +1,192 @@
+#include "exam_stats.h"
+#include "metrics.h"
+
+#define STATS_VERSION 1
+
+vector<shared_ptr<ExamStats>> ExamStats::registry;
+pthread_mutex_t ExamStats::registryMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Creates empty aggregates for an exam.
+ *
+ * @param examName Exam name.
+ * @param questionCount Number of questions (fixes the counter layout).
+ */
+ExamStats::ExamStats(const string& examName, int questionCount)
+    : examName(examName), questionCount(questionCount), lastLsn(0) {
+    pthread_mutex_init(&mutex, nullptr);
+    counts.students = 0;
+    counts.scoreSum = 0;
+    counts.timeSum = 0;
+    counts.minScore = -questionCount;
+    counts.scoreHistogram.assign(5 * questionCount + 1, 0);
+    counts.questions.assign(questionCount, QuestionCounters{});
+}
+
+ExamStats::~ExamStats() {
+    pthread_mutex_destroy(&mutex);
+}
+
+/**
+ * Path of the persisted aggregates of an exam.
+ */
+string ExamStats::statsPath(const string& examName) {
+    return "../data/exams/stats_" + examName + ".bin";
+}
+
+/**
+ * Adds one committed submission to the counters.
+ *
+ * @param s Graded submission.
+ * @param lsn Journal position of the submission.
+ */
+void ExamStats::record(const Submission& s, uint64_t lsn) {
+    if ((int)s.answers.size() != questionCount) {
+        cerr << "Warning: " << examName << " submission has " << s.answers.size()
+             << " answers, expected " << questionCount << endl;
+        return;
+    }
+
+    Metrics::lock(&mutex, LockId::EXAM_STATS);
+    int score = s.totalMarks();
+    counts.students++;
+    counts.scoreSum += score;
+    counts.timeSum += s.totalTime();
+    counts.scoreHistogram[score + questionCount]++;
+    for (int q = 0; q < questionCount; ++q) {
+        QuestionCounters& c = counts.questions[q];
+        c.totalTime += s.times[q];
+        if (s.answers[q] == -1) {
+            c.skipped++;
+            c.options[4]++;
+            continue;
+        }
+        c.attempted++;
+        c.options[s.answers[q]]++;
+        if (s.answers[q] == s.correct[q]) c.correct++;
+    }
+
+    // Advanced under the mutex, so a snapshot sees either the counts and the
+    // LSN of this submission or neither
+    if (lsn > lastLsn.load()) lastLsn = lsn;
+    pthread_mutex_unlock(&mutex);
+}
+
+/**
+ * Copies the totals. Cost is O(questions), whatever the number of students.
+ *
+ * @param appliedLsn If given, receives the last LSN included in the totals.
+ */
+ExamTotals ExamStats::totals(uint64_t* appliedLsn) const {
+    Metrics::lock(&mutex, LockId::EXAM_STATS);
+    ExamTotals t = counts;
+    if (appliedLsn) *appliedLsn = lastLsn.load();
+    pthread_mutex_unlock(&mutex);
+    return t;
+}
+
+/**
+ * Median score, read off the score histogram.
+ */
+double ExamTotals::medianScore() const {
+    if (students == 0) return 0.0;
+
+    // Score of the k-th student (0-based) in ascending order
+    auto kth = [this](uint32_t k) {
+        uint32_t seen = 0;
+        for (size_t i = 0; i < scoreHistogram.size(); ++i) {
+            seen += scoreHistogram[i];
+            if (seen > k) return minScore + (int)i;
+        }
+        return minScore + (int)scoreHistogram.size() - 1;
+    };
+
+    if (students % 2 == 1) return kth(students / 2);
+    return (kth(students / 2 - 1) + kth(students / 2)) / 2.0;
+}
+
+/**
+ * Writes the merged totals and the last applied LSN (temporary file + rename).
+ *
+ * @return True if the file was written.
+ */
+bool ExamStats::save() const {
+    uint64_t lsn;
+    ExamTotals t = totals(&lsn);
+
+    string path = statsPath(examName), tmp = path + ".tmp";
+    ofstream out(tmp, ios::binary | ios::trunc);
+    if (!out) {
+        cerr << "Error: Unable to write " << tmp << endl;
+        return false;
+    }
+
+    uint32_t header[2] = {STATS_VERSION, (uint32_t)questionCount};
+    out.write("EXST", 4);
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(&lsn), sizeof(lsn));
+    out.write(reinterpret_cast<const char*>(&t.students), sizeof(t.students));
+    out.write(reinterpret_cast<const char*>(&t.scoreSum), sizeof(t.scoreSum));
+    out.write(reinterpret_cast<const char*>(&t.timeSum), sizeof(t.timeSum));
+    out.write(reinterpret_cast<const char*>(t.scoreHistogram.data()), t.scoreHistogram.size() * sizeof(uint32_t));
+    out.write(reinterpret_cast<const char*>(t.questions.data()), t.questions.size() * sizeof(QuestionCounters));
+    out.close();
+
+    if (!out || rename(tmp.c_str(), path.c_str()) != 0) {
+        cerr << "Error: Unable to save " << path << endl;
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Restores persisted totals. Called once, before the stats are shared.
+ *
+ * @return False if there is no file or it does not match this exam's layout.
+ */
+bool ExamStats::load() {
+    ifstream in(statsPath(examName), ios::binary);
+    if (!in) return false;
+
+    char magic[4];
+    uint32_t header[2];
+    uint64_t lsn;
+    in.read(magic, 4);
+    in.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!in || string(magic, 4) != "EXST" || header[0] != STATS_VERSION || (int)header[1] != questionCount) return false;
+
+    ExamTotals loaded = counts;
+    in.read(reinterpret_cast<char*>(&lsn), sizeof(lsn));
+    in.read(reinterpret_cast<char*>(&loaded.students), sizeof(loaded.students));
+    in.read(reinterpret_cast<char*>(&loaded.scoreSum), sizeof(loaded.scoreSum));
+    in.read(reinterpret_cast<char*>(&loaded.timeSum), sizeof(loaded.timeSum));
+    in.read(reinterpret_cast<char*>(loaded.scoreHistogram.data()), loaded.scoreHistogram.size() * sizeof(uint32_t));
+    in.read(reinterpret_cast<char*>(loaded.questions.data()), loaded.questions.size() * sizeof(QuestionCounters));
+    if (!in) return false;
+
+    counts = move(loaded);
+    lastLsn = lsn;
+    return true;
+}
+
+/**
+ * Returns the aggregates of an exam, loading the persisted file (or starting
+ * empty) on first use.
+ *
+ * @param examName Exam name.
+ * @param questionCount Number of questions of the exam.
+ */
+shared_ptr<ExamStats> ExamStats::forExam(const string& examName, int questionCount) {
+    uint32_t examId = NameDictionary::intern(NameKind::EXAM, examName);
+    pthread_mutex_lock(&registryMutex);
+    if (examId >= registry.size()) registry.resize(examId + 1);
+    shared_ptr<ExamStats>& stats = registry[examId];
+    if (!stats) {
+        stats = make_shared<ExamStats>(examName, questionCount);
+        stats->load();
+    }
+    shared_ptr<ExamStats> result = stats;
+    pthread_mutex_unlock(&registryMutex);
+    return result;
+}
@@ -0,0 +1,72 @@
+#ifndef EXAM_STATS_H
+#define EXAM_STATS_H
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "submission.h"
+#include "name_dictionary.h"
+
+using namespace std;
+
+// Per-question counters of an exam
+struct QuestionCounters {
+    uint32_t attempted;
+    uint32_t correct;
+    uint32_t skipped;
+    uint64_t totalTime;         // seconds, summed over students
+    uint32_t options[5];        // students choosing A, B, C, D, or skipping (NA)
+};
+
+// Merged view of an exam's aggregates, as used to render the analysis report
+struct ExamTotals {
+    uint32_t students;
+    int64_t scoreSum;
+    uint64_t timeSum;
+    int minScore;                       // score of histogram[0] (= -questions)
+    vector<uint32_t> scoreHistogram;    // students per score, from minScore to 4 * questions
+    vector<QuestionCounters> questions;
+
+    double medianScore() const;
+};
+
+// Analysis aggregates of one exam, updated as each submission is committed.
+// Submissions are recorded by the journal committer (or replay at startup)
+// alone, so one set of counters under one mutex suffices; readers copy it.
+// The totals are persisted to ../data/exams/stats_<exam>.bin together with
+// the last journal LSN applied.
+class ExamStats {
+public:
+    ExamStats(const string& examName, int questionCount);
+    ~ExamStats();
+
+    void record(const Submission& submission, uint64_t lsn);
+    ExamTotals totals(uint64_t* appliedLsn = nullptr) const;
+    bool save() const;
+    uint64_t appliedLsn() const { return lastLsn.load(); }
+
+    static shared_ptr<ExamStats> forExam(const string& examName, int questionCount);
+    static string statsPath(const string& examName);
+
+private:
+    string examName;
+    int questionCount;
+    mutable pthread_mutex_t mutex;
+    ExamTotals counts;
+    atomic<uint64_t> lastLsn;
+
+    bool load();
+
+    static vector<shared_ptr<ExamStats>> registry;     // by exam ID
+    static pthread_mutex_t registryMutex;
+};
+
+#endif
@@ -0,0 +1,256 @@
+#include "journal.h"
+
+#define RECORD_HEADER 8
+
+/**
+ * Prepares a journal; nothing is opened until open() is called.
+ *
+ * @param path Journal file.
+ * @param maxBatch Maximum number of records written by one commit.
+ */
+Journal::Journal(const string& path, size_t maxBatch)
+    : path(path), maxBatch(maxBatch > 0 ? maxBatch : 1), fd(-1), nextLsn(1), size(0),
+      running(false), stopping(false), records(0), commits(0), failed(0), largestBatch(0), totalSyncUs(0) {
+    pthread_mutex_init(&mutex, nullptr);
+    pthread_cond_init(&notEmpty, nullptr);
+}
+
+/**
+ * Commits whatever is still queued, then stops the committer thread.
+ */
+Journal::~Journal() {
+    if (running) {
+        pthread_mutex_lock(&mutex);
+        stopping = true;
+        pthread_cond_signal(&notEmpty);
+        pthread_mutex_unlock(&mutex);
+        pthread_join(committer, nullptr);
+    }
+    if (fd != -1) close(fd);
+    pthread_cond_destroy(&notEmpty);
+    pthread_mutex_destroy(&mutex);
+}
+
+/**
+ * Computes the CRC-32 (IEEE) of a buffer.
+ */
+uint32_t Journal::crc32(const string& data) {
+    static uint32_t table[256];
+    static bool ready = false;
+    if (!ready) {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        ready = true;
+    }
+
+    uint32_t crc = 0xFFFFFFFF;
+    for (unsigned char b : data) crc = table[(crc ^ b) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFF;
+}
+
+static void putU32(string& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+}
+
+static uint32_t getU32(const unsigned char* p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+/**
+ * Opens (or creates) the journal, reads back every intact record and starts
+ * the committer thread. A torn or corrupt tail is truncated away.
+ *
+ * @param records Receives the payloads already in the journal, in order.
+ * @return False if the file could not be opened.
+ */
+bool Journal::open(vector<string>& records) {
+    crc32("");  // build the CRC table before any other thread can race on it
+
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (fd == -1) {
+        cerr << "Error: Unable to open journal " << path << endl;
+        return false;
+    }
+
+    // Read the whole journal; it only grows by small records
+    string data;
+    char buffer[65536];
+    ssize_t n;
+    while ((n = pread(fd, buffer, sizeof(buffer), data.size())) > 0) data.append(buffer, n);
+
+    size_t offset = 0;
+    while (offset + RECORD_HEADER <= data.size()) {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(data.data() + offset);
+        uint32_t len = getU32(p), crc = getU32(p + 4);
+        if (offset + RECORD_HEADER + len > data.size()) break;
+
+        string payload = data.substr(offset + RECORD_HEADER, len);
+        if (crc32(payload) != crc) break;
+
+        records.push_back(move(payload));
+        offset += RECORD_HEADER + len;
+    }
+
+    if (offset != data.size()) {
+        cerr << "Warning: discarding " << data.size() - offset << " bytes of torn journal tail" << endl;
+        if (ftruncate(fd, offset) == -1) {
+            cerr << "Error: Unable to truncate journal " << path << endl;
+            return false;
+        }
+    }
+
+    size = offset;
+    nextLsn = records.size() + 1;
+    cout << "[+] journal " << path << ": " << records.size() << " records replayed" << endl;
+
+    if (pthread_create(&committer, nullptr, committerMain, this) != 0) {
+        cerr << "Error: Could not start journal committer thread\n";
+        return false;
+    }
+    running = true;
+    return true;
+}
+
+/**
+ * Writes records recovered from elsewhere as one durable batch, without the
+ * applier or callbacks. Only for startup, before the first append().
+ *
+ * @param payloads Records to add, in order.
+ * @return False if they could not be written (the journal is left as it was).
+ */
+bool Journal::import(const vector<string>& payloads) {
+    string buffer;
+    for (const string& payload : payloads) {
+        putU32(buffer, payload.size());
+        putU32(buffer, crc32(payload));
+        buffer += payload;
+    }
+    if (!writeBatch(buffer)) return false;
+    nextLsn += payloads.size();
+    return true;
+}
+
+/**
+ * Installs the function that brings derived views up to date with each
+ * committed batch; it receives the LSN of the batch's first record.
+ */
+void Journal::setApplier(function<void(uint64_t firstLsn, const vector<string>&)> fn) {
+    applier = move(fn);
+}
+
+/**
+ * Queues a record for the next group commit. Never blocks on disk.
+ *
+ * @param payload Record bytes.
+ * @param callback Run on the committer thread once the record is durable.
+ */
+void Journal::append(const string& payload, CommitCallback callback) {
+    pthread_mutex_lock(&mutex);
+    queue.push_back({payload, move(callback)});
+    pthread_cond_signal(&notEmpty);
+    pthread_mutex_unlock(&mutex);
+}
+
+/**
+ * Returns a consistent snapshot of the journal counters.
+ */
+JournalStats Journal::stats() {
+    pthread_mutex_lock(&mutex);
+    JournalStats s{records, commits, failed, largestBatch, totalSyncUs, queue.size()};
+    pthread_mutex_unlock(&mutex);
+    return s;
+}
+
+void* Journal::committerMain(void* arg) {
+    static_cast<Journal*>(arg)->runCommitter();
+    return nullptr;
+}
+
+/**
+ * Committer loop: everything that piled up while the previous fdatasync was
+ * running goes to disk together, so a burst of submissions costs a handful
+ * of syncs instead of one per student.
+ */
+void Journal::runCommitter() {
+    while (true) {
+        pthread_mutex_lock(&mutex);
+        while (queue.empty() && !stopping) pthread_cond_wait(&notEmpty, &mutex);
+        if (queue.empty() && stopping) {
+            pthread_mutex_unlock(&mutex);
+            return;
+        }
+
+        vector<Entry> batch;
+        while (!queue.empty() && batch.size() < maxBatch) {
+            batch.push_back(move(queue.front()));
+            queue.pop_front();
+        }
+        pthread_mutex_unlock(&mutex);
+
+        // Frame every record and write the batch in one go
+        string buffer;
+        for (const Entry& e : batch) {
+            putU32(buffer, e.payload.size());
+            putU32(buffer, crc32(e.payload));
+            buffer += e.payload;
+        }
+
+        auto started = chrono::steady_clock::now();
+        bool ok = writeBatch(buffer);
+        uint64_t syncUs = chrono::duration_cast<chrono::microseconds>(
+            chrono::steady_clock::now() - started).count();
+
+        uint64_t firstLsn = nextLsn;
+        if (ok) {
+            nextLsn += batch.size();
+            if (applier) {
+                vector<string> payloads;
+                for (const Entry& e : batch) payloads.push_back(e.payload);
+                applier(firstLsn, payloads);
+            }
+        }
+
+        pthread_mutex_lock(&mutex);
+        commits++;
+        totalSyncUs += syncUs;
+        if (ok) records += batch.size();
+        else failed += batch.size();
+        if (batch.size() > largestBatch) largestBatch = batch.size();
+        pthread_mutex_unlock(&mutex);
+
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (batch[i].callback) batch[i].callback(ok, ok ? firstLsn + i : 0);
+        }
+    }
+}
+
+/**
+ * Appends a batch and makes it durable. On failure the file is cut back to
+ * its previous size so no partial record is left behind.
+ *
+ * @param buffer Framed records.
+ * @return True once write() and fdatasync() both succeeded.
+ */
+bool Journal::writeBatch(const string& buffer) {
+    size_t written = 0;
+    while (written < buffer.size()) {
+        ssize_t n = write(fd, buffer.data() + written, buffer.size() - written);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        written += n;
+    }
+
+    if (written == buffer.size() && fdatasync(fd) == 0) {
+        size += buffer.size();
+        return true;
+    }
+
+    cerr << "Error: Journal write failed, " << buffer.size() << " bytes rolled back" << endl;
+    if (ftruncate(fd, size) == -1) cerr << "Error: Unable to roll back journal " << path << endl;
+    return false;
+}
@@ -0,0 +1,81 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+#include <cerrno>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+// Called once a record is durable (or failed to be written). lsn is the
+// record's position in the journal, starting at 1.
+typedef function<void(bool committed, uint64_t lsn)> CommitCallback;
+
+// Snapshot of journal counters
+struct JournalStats {
+    uint64_t records;           // records committed since startup
+    uint64_t commits;           // write + fdatasync rounds
+    uint64_t failed;            // records whose commit failed
+    uint64_t maxBatch;          // largest number of records in one commit
+    uint64_t totalSyncUs;       // time spent in write + fdatasync
+    size_t queued;              // records waiting for the next commit
+};
+
+// Append-only log of opaque records with group commit: a committer thread
+// takes everything appended since the previous round, writes it with one
+// write() and one fdatasync(), then runs the callbacks.
+//
+// On disk every record is [payload length: 4 bytes][crc32: 4 bytes][payload],
+// little-endian. A torn record at the tail (crash mid-write) is cut off on open.
+class Journal {
+public:
+    Journal(const string& path, size_t maxBatch);
+    ~Journal();
+
+    bool open(vector<string>& records);
+    bool import(const vector<string>& payloads);
+    void setApplier(function<void(uint64_t firstLsn, const vector<string>&)> applier);
+    void append(const string& payload, CommitCallback callback);
+    JournalStats stats();
+
+    static uint32_t crc32(const string& data);
+
+private:
+    struct Entry {
+        string payload;
+        CommitCallback callback;
+    };
+
+    string path;
+    size_t maxBatch;
+    int fd;
+    uint64_t nextLsn;
+    off_t size;
+
+    // Runs on the committer thread after a batch is durable, before callbacks
+    function<void(uint64_t firstLsn, const vector<string>&)> applier;
+
+    pthread_t committer;
+    bool running;
+    bool stopping;
+    pthread_mutex_t mutex;
+    pthread_cond_t notEmpty;
+    deque<Entry> queue;
+
+    uint64_t records, commits, failed, largestBatch, totalSyncUs;
+
+    static void* committerMain(void* arg);
+    void runCommitter();
+    bool writeBatch(const string& buffer);
+};
+
+#endif
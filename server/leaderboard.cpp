@@ -0,0 +1,142 @@
+#include "leaderboard.h"
+
+vector<shared_ptr<Leaderboard>> Leaderboard::registry;
+pthread_mutex_t Leaderboard::registryMutex = PTHREAD_MUTEX_INITIALIZER;
+
+Leaderboard::Leaderboard() {
+    pthread_rwlock_init(&lock, nullptr);
+}
+
+Leaderboard::~Leaderboard() {
+    pthread_rwlock_destroy(&lock);
+}
+
+/**
+ * Ranks one committed attempt. Adding the same journal record twice is a no-op.
+ *
+ * @param s Graded submission.
+ * @param lsn Journal position of the submission.
+ */
+void Leaderboard::add(const Submission& s, uint64_t lsn) {
+    RankKey key{s.totalMarks(), s.totalTime(), lsn};
+    RankKeyOrder before;
+    uint32_t studentId = NameDictionary::intern(NameKind::STUDENT, s.studentId);
+
+    pthread_rwlock_wrlock(&lock);
+    if (ranked.insert({key, make_shared<const Submission>(s)}).second) {
+        byLsn[lsn] = key;
+        auto it = best.find(studentId);
+        if (it == best.end() || before(key, it->second)) best[studentId] = key;
+    }
+    pthread_rwlock_unlock(&lock);
+}
+
+/**
+ * Number of ranked attempts.
+ */
+size_t Leaderboard::size() const {
+    pthread_rwlock_rdlock(&lock);
+    size_t n = ranked.size();
+    pthread_rwlock_unlock(&lock);
+    return n;
+}
+
+/**
+ * Rank of a student's best attempt.
+ *
+ * @param studentId Student ID.
+ * @return 1-based rank, or 0 if the student has no attempt.
+ */
+size_t Leaderboard::rankOf(const string& studentId) const {
+    uint32_t id;
+    if (!NameDictionary::find(NameKind::STUDENT, studentId, id)) return 0;
+
+    pthread_rwlock_rdlock(&lock);
+    auto it = best.find(id);
+    size_t rank = (it == best.end()) ? 0 : ranked.order_of_key(it->second) + 1;
+    pthread_rwlock_unlock(&lock);
+    return rank;
+}
+
+/**
+ * Percentage of attempts ranked at or below the student's best attempt.
+ *
+ * @param studentId Student ID.
+ * @return Percentile in (0, 100], or 0 if the student has no attempt.
+ */
+double Leaderboard::percentileOf(const string& studentId) const {
+    uint32_t id;
+    if (!NameDictionary::find(NameKind::STUDENT, studentId, id)) return 0.0;
+
+    pthread_rwlock_rdlock(&lock);
+    auto it = best.find(id);
+    double percentile = 0.0;
+    if (it != best.end()) {
+        size_t rank = ranked.order_of_key(it->second) + 1;
+        percentile = 100.0 * (ranked.size() - rank + 1) / ranked.size();
+    }
+    pthread_rwlock_unlock(&lock);
+    return percentile;
+}
+
+/**
+ * The k best attempts.
+ */
+vector<Standing> Leaderboard::top(size_t k) const {
+    return page(0, k);
+}
+
+/**
+ * One page of the leaderboard.
+ *
+ * @param n 0-based page number.
+ * @param pageSize Rows per page.
+ * @return Up to pageSize rows, starting at rank n * pageSize + 1.
+ */
+vector<Standing> Leaderboard::page(size_t n, size_t pageSize) const {
+    vector<Standing> rows;
+
+    pthread_rwlock_rdlock(&lock);
+    size_t first = n * pageSize;
+    auto it = ranked.find_by_order(first);
+    for (size_t i = 0; i < pageSize && it != ranked.end(); ++i, ++it) {
+        rows.push_back({first + i + 1, it->first.lsn, it->second});
+    }
+    pthread_rwlock_unlock(&lock);
+    return rows;
+}
+
+/**
+ * Looks up one attempt by its journal position.
+ *
+ * @param lsn Journal position of the attempt.
+ * @param out Filled with the attempt and its current rank.
+ * @return False if the attempt is not on this leaderboard.
+ */
+bool Leaderboard::attempt(uint64_t lsn, Standing& out) const {
+    pthread_rwlock_rdlock(&lock);
+    auto it = byLsn.find(lsn);
+    bool found = it != byLsn.end();
+    if (found) {
+        auto node = ranked.find(it->second);
+        out = {ranked.order_of_key(it->second) + 1, lsn, node->second};
+    }
+    pthread_rwlock_unlock(&lock);
+    return found;
+}
+
+/**
+ * Returns the leaderboard of an exam, creating an empty one on first use.
+ *
+ * @param examName Exam name.
+ */
+shared_ptr<Leaderboard> Leaderboard::forExam(const string& examName) {
+    uint32_t examId = NameDictionary::intern(NameKind::EXAM, examName);
+    pthread_mutex_lock(&registryMutex);
+    if (examId >= registry.size()) registry.resize(examId + 1);
+    shared_ptr<Leaderboard>& board = registry[examId];
+    if (!board) board = make_shared<Leaderboard>();
+    shared_ptr<Leaderboard> result = board;
+    pthread_mutex_unlock(&registryMutex);
+    return result;
+}
@@ -0,0 +1,75 @@
+#ifndef LEADERBOARD_H
+#define LEADERBOARD_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <cstdint>
+#include <pthread.h>
+#include <ext/pb_ds/assoc_container.hpp>
+#include <ext/pb_ds/tree_policy.hpp>
+
+#include "submission.h"
+#include "name_dictionary.h"
+
+using namespace std;
+
+// Position of one attempt: higher score first, then less time, then earlier submission
+struct RankKey {
+    int score;
+    uint32_t time;
+    uint64_t lsn;
+};
+
+struct RankKeyOrder {
+    bool operator()(const RankKey& a, const RankKey& b) const {
+        if (a.score != b.score) return a.score > b.score;
+        if (a.time != b.time) return a.time < b.time;
+        return a.lsn < b.lsn;
+    }
+};
+
+// One leaderboard row
+struct Standing {
+    size_t rank;                        // 1-based
+    uint64_t lsn;                       // journal position, identifies the attempt
+    shared_ptr<const Submission> submission;
+};
+
+// Ranked attempts of one exam, kept in an order-statistic tree so rank,
+// percentile, top-K and page queries cost O(log n) (plus the rows returned)
+// instead of a sort per request. Built from the journal at startup and
+// updated as each submission is committed.
+class Leaderboard {
+public:
+    Leaderboard();
+    ~Leaderboard();
+
+    void add(const Submission& submission, uint64_t lsn);
+    size_t size() const;
+    size_t rankOf(const string& studentId) const;
+    double percentileOf(const string& studentId) const;
+    vector<Standing> top(size_t k) const;
+    vector<Standing> page(size_t n, size_t pageSize) const;
+    bool attempt(uint64_t lsn, Standing& out) const;
+
+    static shared_ptr<Leaderboard> forExam(const string& examName);
+
+private:
+    typedef __gnu_pbds::tree<RankKey, shared_ptr<const Submission>, RankKeyOrder,
+                             __gnu_pbds::rb_tree_tag,
+                             __gnu_pbds::tree_order_statistics_node_update> RankTree;
+
+    RankTree ranked;
+    unordered_map<uint32_t, RankKey> best;      // student ID -> best attempt
+    unordered_map<uint64_t, RankKey> byLsn;     // attempt -> position key
+    mutable pthread_rwlock_t lock;
+
+    static vector<shared_ptr<Leaderboard>> registry;   // by exam ID
+    static pthread_mutex_t registryMutex;
+};
+
+#endif
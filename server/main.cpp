@@ -2,8 +2,12 @@
 // Entry point for the server-side application.
 
 #include "server.h"  // Include server class definition
+#include "config.h"  // Include server tunables
 
 int main() {
+    // Load tunables (worker pool size, overload policy, ...)
+    ServerConfig::load("../data/server.conf");
+
     // Create a server object listening on port 8080
     Server server(8080);
 
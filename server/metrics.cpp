@@ -0,0 +1,336 @@
+#include "metrics.h"
+
+LatencyHistogram Metrics::latency[(int)Op::COUNT];
+atomic<uint64_t> Metrics::failures[(int)Op::COUNT];
+atomic<int64_t> Metrics::sessions(0);
+atomic<uint64_t> Metrics::lockAcquired[(int)LockId::COUNT];
+atomic<uint64_t> Metrics::lockContended[(int)LockId::COUNT];
+atomic<uint64_t> Metrics::lockWaitNs[(int)LockId::COUNT];
+vector<function<void(ostream&)>> Metrics::collectors;
+pthread_mutex_t Metrics::collectorMutex = PTHREAD_MUTEX_INITIALIZER;
+int Metrics::listenFd = -1;
+int Metrics::signalPipe[2] = {-1, -1};
+
+static const char* opNames[(int)Op::COUNT] = {
+    "login", "register", "resume", "exam_list", "paper_download", "submission", "dashboard", "analysis"
+};
+static const char* lockNames[(int)LockId::COUNT] = {
+    "user_store", "session_tokens", "paper_cache", "exam_seal", "exam_stats"
+};
+
+// Histogram boundaries exported as Prometheus buckets (microseconds)
+static const uint64_t exportedBounds[] = {
+    50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000,
+    100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000
+};
+
+LatencyHistogram::LatencyHistogram() : total(0), sum(0) {
+    for (auto& c : counts) c.store(0, memory_order_relaxed);
+}
+
+/**
+ * Bucket of a value: exact below 32 us, then 32 buckets per power of two.
+ */
+int LatencyHistogram::indexOf(uint64_t micros) {
+    if (micros < (uint64_t)SUB_BUCKETS) return micros;
+
+    int exponent = 63 - __builtin_clzll(micros);
+    if (exponent > MAX_EXPONENT) return BUCKETS - 1;
+    int shift = exponent - SUB_BITS;
+    int sub = (micros >> shift) - SUB_BUCKETS;
+    return SUB_BUCKETS + shift * SUB_BUCKETS + sub;
+}
+
+/**
+ * Largest value that falls into a bucket.
+ */
+uint64_t LatencyHistogram::upperBound(int index) {
+    if (index < SUB_BUCKETS) return index;
+
+    int shift = (index - SUB_BUCKETS) / SUB_BUCKETS;
+    int sub = (index - SUB_BUCKETS) % SUB_BUCKETS;
+    uint64_t lower = (uint64_t)(SUB_BUCKETS + sub) << shift;
+    return lower + (1ULL << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t micros) {
+    counts[indexOf(micros)].fetch_add(1, memory_order_relaxed);
+    total.fetch_add(1, memory_order_relaxed);
+    sum.fetch_add(micros, memory_order_relaxed);
+}
+
+/**
+ * Value below which a fraction p of the recorded latencies fall.
+ *
+ * @param p Fraction in (0, 1].
+ * @return Upper bound of the bucket that holds the p-th value, in microseconds.
+ */
+uint64_t LatencyHistogram::percentile(double p) const {
+    uint64_t n = count();
+    if (n == 0) return 0;
+
+    uint64_t target = (uint64_t)(p * n + 0.5);
+    if (target == 0) target = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; ++i) {
+        seen += counts[i].load(memory_order_relaxed);
+        if (seen >= target) return upperBound(i);
+    }
+    return upperBound(BUCKETS - 1);
+}
+
+/**
+ * Number of recorded latencies whose bucket lies entirely at or below a bound.
+ */
+uint64_t LatencyHistogram::countAtOrBelow(uint64_t micros) const {
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS && upperBound(i) <= micros; ++i)
+        seen += counts[i].load(memory_order_relaxed);
+    return seen;
+}
+
+/**
+ * Records the server-side latency of one request.
+ *
+ * @param op Operation the request belongs to.
+ * @param start When the request was dispatched.
+ * @param ok False if the request failed (bad login, rejected sheet, ...).
+ */
+void Metrics::observe(Op op, chrono::steady_clock::time_point start, bool ok) {
+    uint64_t micros = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+    latency[(int)op].record(micros);
+    if (!ok) failures[(int)op].fetch_add(1, memory_order_relaxed);
+}
+
+void Metrics::sessionOpened() {
+    sessions.fetch_add(1, memory_order_relaxed);
+}
+
+void Metrics::sessionClosed() {
+    sessions.fetch_sub(1, memory_order_relaxed);
+}
+
+/**
+ * Locks a shared mutex, accounting the time spent waiting if it was held.
+ *
+ * @param mutex Mutex to lock; unlock it with pthread_mutex_unlock as usual.
+ * @param id Which mutex it is, for the exported label.
+ */
+void Metrics::lock(pthread_mutex_t* mutex, LockId id) {
+    lockAcquired[(int)id].fetch_add(1, memory_order_relaxed);
+    if (pthread_mutex_trylock(mutex) == 0) return;
+
+    auto t0 = chrono::steady_clock::now();
+    pthread_mutex_lock(mutex);
+    lockWaited(id, t0);
+}
+
+/**
+ * Takes a shared reader-writer lock for reading, accounted like lock().
+ */
+void Metrics::lockRead(pthread_rwlock_t* lock, LockId id) {
+    lockAcquired[(int)id].fetch_add(1, memory_order_relaxed);
+    if (pthread_rwlock_tryrdlock(lock) == 0) return;
+
+    auto t0 = chrono::steady_clock::now();
+    pthread_rwlock_rdlock(lock);
+    lockWaited(id, t0);
+}
+
+/**
+ * Takes a shared reader-writer lock for writing, accounted like lock().
+ */
+void Metrics::lockWrite(pthread_rwlock_t* lock, LockId id) {
+    lockAcquired[(int)id].fetch_add(1, memory_order_relaxed);
+    if (pthread_rwlock_trywrlock(lock) == 0) return;
+
+    auto t0 = chrono::steady_clock::now();
+    pthread_rwlock_wrlock(lock);
+    lockWaited(id, t0);
+}
+
+void Metrics::lockWaited(LockId id, chrono::steady_clock::time_point start) {
+    uint64_t waited = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+    lockContended[(int)id].fetch_add(1, memory_order_relaxed);
+    lockWaitNs[(int)id].fetch_add(waited, memory_order_relaxed);
+}
+
+/**
+ * Adds a function that writes extra metric families (worker pool, journal, ...)
+ * to every scrape.
+ */
+void Metrics::addCollector(function<void(ostream&)> collector) {
+    pthread_mutex_lock(&collectorMutex);
+    collectors.push_back(move(collector));
+    pthread_mutex_unlock(&collectorMutex);
+}
+
+/**
+ * Thread count of the process, from /proc/self/status.
+ */
+int Metrics::processThreads() {
+    ifstream status("/proc/self/status");
+    string line;
+    while (getline(status, line)) {
+        if (line.compare(0, 8, "Threads:") == 0) return atoi(line.c_str() + 8);
+    }
+    return 0;
+}
+
+/**
+ * Writes the _bucket, _sum and _count series of one histogram (in seconds).
+ *
+ * @param out Destination stream.
+ * @param name Metric name.
+ * @param labels Label pairs without braces, e.g. op="login".
+ * @param h Histogram to export.
+ */
+void Metrics::writeHistogram(ostream& out, const string& name, const string& labels, const LatencyHistogram& h) {
+    for (uint64_t bound : exportedBounds)
+        out << name << "_bucket{" << labels << ",le=\"" << bound / 1e6 << "\"} " << h.countAtOrBelow(bound) << "\n";
+    out << name << "_bucket{" << labels << ",le=\"+Inf\"} " << h.count() << "\n";
+    out << name << "_sum{" << labels << "} " << h.sumMicros() / 1e6 << "\n";
+    out << name << "_count{" << labels << "} " << h.count() << "\n";
+}
+
+/**
+ * Renders every metric in the Prometheus text exposition format.
+ */
+string Metrics::render() {
+    ostringstream out;
+    out << fixed << setprecision(6);
+
+    out << "# HELP exam_requests_total Requests handled, by operation and outcome.\n";
+    out << "# TYPE exam_requests_total counter\n";
+    for (int op = 0; op < (int)Op::COUNT; ++op) {
+        uint64_t failed = failures[op].load(memory_order_relaxed);
+        out << "exam_requests_total{op=\"" << opNames[op] << "\",result=\"ok\"} " << latency[op].count() - failed << "\n";
+        out << "exam_requests_total{op=\"" << opNames[op] << "\",result=\"error\"} " << failed << "\n";
+    }
+
+    out << "# HELP exam_request_duration_seconds Time from dispatching a request to queuing its reply.\n";
+    out << "# TYPE exam_request_duration_seconds histogram\n";
+    for (int op = 0; op < (int)Op::COUNT; ++op)
+        writeHistogram(out, "exam_request_duration_seconds", string("op=\"") + opNames[op] + "\"", latency[op]);
+
+    out << "# HELP exam_request_duration_quantile_seconds Latency percentiles from the full-resolution histogram.\n";
+    out << "# TYPE exam_request_duration_quantile_seconds gauge\n";
+    for (int op = 0; op < (int)Op::COUNT; ++op) {
+        for (const char* q : {"0.5", "0.9", "0.95", "0.99", "0.999"}) {
+            out << "exam_request_duration_quantile_seconds{op=\"" << opNames[op] << "\",quantile=\"" << q << "\"} "
+                << latency[op].percentile(atof(q)) / 1e6 << "\n";
+        }
+    }
+
+    out << "# HELP exam_sessions_active Connected clients.\n";
+    out << "# TYPE exam_sessions_active gauge\n";
+    out << "exam_sessions_active " << sessions.load(memory_order_relaxed) << "\n";
+
+    out << "# HELP exam_process_threads Threads in the server process.\n";
+    out << "# TYPE exam_process_threads gauge\n";
+    out << "exam_process_threads " << processThreads() << "\n";
+
+    out << "# HELP exam_mutex_acquisitions_total Shared locks taken.\n";
+    out << "# TYPE exam_mutex_acquisitions_total counter\n";
+    for (int id = 0; id < (int)LockId::COUNT; ++id)
+        out << "exam_mutex_acquisitions_total{mutex=\"" << lockNames[id] << "\"} " << lockAcquired[id].load() << "\n";
+    out << "# HELP exam_mutex_contended_total Locks that had to wait for another holder.\n";
+    out << "# TYPE exam_mutex_contended_total counter\n";
+    for (int id = 0; id < (int)LockId::COUNT; ++id)
+        out << "exam_mutex_contended_total{mutex=\"" << lockNames[id] << "\"} " << lockContended[id].load() << "\n";
+    out << "# HELP exam_mutex_wait_seconds_total Time spent waiting for shared locks.\n";
+    out << "# TYPE exam_mutex_wait_seconds_total counter\n";
+    for (int id = 0; id < (int)LockId::COUNT; ++id)
+        out << "exam_mutex_wait_seconds_total{mutex=\"" << lockNames[id] << "\"} " << lockWaitNs[id].load() / 1e9 << "\n";
+
+    pthread_mutex_lock(&collectorMutex);
+    for (auto& collector : collectors) collector(out);
+    pthread_mutex_unlock(&collectorMutex);
+    return out.str();
+}
+
+void Metrics::onSignal(int signo) {
+    char byte = 1;
+    ssize_t n = write(signalPipe[1], &byte, 1);
+    (void)n;
+}
+
+/**
+ * Starts the exporter thread: serves the metrics over HTTP on 127.0.0.1:port
+ * (any path) and prints them to stdout when the process receives SIGUSR1.
+ *
+ * @param port Local port, or 0 to rely on SIGUSR1 only.
+ * @return False if the port could not be bound.
+ */
+bool Metrics::startExporter(int port) {
+    if (port > 0) {
+        listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        int opt = 1;
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(listenFd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listenFd, 16) < 0) {
+            cerr << "Error: Unable to serve metrics on port " << port << endl;
+            close(listenFd);
+            listenFd = -1;
+        }
+    }
+
+    if (pipe(signalPipe) == 0) {
+        struct sigaction sa{};
+        sa.sa_handler = onSignal;
+        sa.sa_flags = SA_RESTART;
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGUSR1, &sa, nullptr);
+    }
+
+    pthread_t thread;
+    pthread_create(&thread, nullptr, exporterMain, nullptr);
+    pthread_detach(thread);
+
+    if (listenFd >= 0) cout << "[+] metrics on http://127.0.0.1:" << port << "/metrics" << endl;
+    return port <= 0 || listenFd >= 0;
+}
+
+void* Metrics::exporterMain(void*) {
+    while (true) {
+        pollfd fds[2] = {{signalPipe[0], POLLIN, 0}, {listenFd, POLLIN, 0}};
+        int n = poll(fds, listenFd >= 0 ? 2 : 1, -1);
+        if (n < 0) continue;
+
+        // SIGUSR1: dump to stdout
+        if (fds[0].revents & POLLIN) {
+            char drain[64];
+            ssize_t got = read(signalPipe[0], drain, sizeof(drain));
+            (void)got;
+            cout << render() << flush;
+        }
+
+        // Scrape: answer any request with the current metrics
+        if (listenFd >= 0 && (fds[1].revents & POLLIN)) {
+            int client = accept(listenFd, nullptr, nullptr);
+            if (client < 0) continue;
+
+            timeval timeout{1, 0};
+            setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            char request[1024];
+            ssize_t got = recv(client, request, sizeof(request), 0);
+            (void)got;
+
+            string body = render();
+            string response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                              to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+            size_t sent = 0;
+            while (sent < response.size()) {
+                ssize_t w = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+                if (w <= 0) break;
+                sent += w;
+            }
+            close(client);
+        }
+    }
+    return nullptr;
+}
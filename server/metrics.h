@@ -0,0 +1,94 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <cstdint>
+#include <cstring>
+#include <csignal>
+#include <pthread.h>
+#include <unistd.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+using namespace std;
+
+// Protocol operations with their own latency histogram
+enum class Op { LOGIN, REGISTER, RESUME, EXAM_LIST, PAPER, SUBMISSION, DASHBOARD, ANALYSIS, COUNT };
+
+// Shared locks whose wait time is accounted
+enum class LockId { USER_STORE, SESSION_TOKENS, PAPER_CACHE, EXAM_SEAL, EXAM_STATS, COUNT };
+
+// Log-linear latency histogram in microseconds, HDR style: 32 linear
+// sub-buckets per power of two, so any recorded value is known to within ~3%.
+// Recording is a single relaxed atomic increment.
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    void record(uint64_t micros);
+    uint64_t count() const { return total.load(memory_order_relaxed); }
+    uint64_t sumMicros() const { return sum.load(memory_order_relaxed); }
+    uint64_t percentile(double p) const;
+    uint64_t countAtOrBelow(uint64_t micros) const;
+
+private:
+    static const int SUB_BITS = 5;
+    static const int SUB_BUCKETS = 1 << SUB_BITS;
+    static const int MAX_EXPONENT = 40;                 // values are capped at ~12 days
+    static const int BUCKETS = SUB_BUCKETS * (MAX_EXPONENT - SUB_BITS + 2);
+
+    atomic<uint64_t> counts[BUCKETS];
+    atomic<uint64_t> total;
+    atomic<uint64_t> sum;
+
+    static int indexOf(uint64_t micros);
+    static uint64_t upperBound(int index);
+};
+
+// Process-wide counters, gauges and latency histograms, exposed in the
+// Prometheus text format on a local port and dumped to stdout on SIGUSR1
+class Metrics {
+public:
+    static void observe(Op op, chrono::steady_clock::time_point start, bool ok = true);
+    static void sessionOpened();
+    static void sessionClosed();
+    static void lock(pthread_mutex_t* mutex, LockId id);
+    static void lockRead(pthread_rwlock_t* lock, LockId id);
+    static void lockWrite(pthread_rwlock_t* lock, LockId id);
+    static void addCollector(function<void(ostream&)> collector);
+    static void writeHistogram(ostream& out, const string& name, const string& labels, const LatencyHistogram& h);
+
+    static string render();
+    static bool startExporter(int port);
+
+private:
+    static LatencyHistogram latency[(int)Op::COUNT];
+    static atomic<uint64_t> failures[(int)Op::COUNT];
+    static atomic<int64_t> sessions;
+    static atomic<uint64_t> lockAcquired[(int)LockId::COUNT];
+    static atomic<uint64_t> lockContended[(int)LockId::COUNT];
+    static atomic<uint64_t> lockWaitNs[(int)LockId::COUNT];
+
+    static vector<function<void(ostream&)>> collectors;
+    static pthread_mutex_t collectorMutex;
+
+    static int listenFd;
+    static int signalPipe[2];
+
+    static void lockWaited(LockId id, chrono::steady_clock::time_point start);
+    static void* exporterMain(void* arg);
+    static void onSignal(int signo);
+    static int processThreads();
+};
+
+#endif
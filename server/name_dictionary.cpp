@@ -0,0 +1,146 @@
+#include "name_dictionary.h"
+
+static const char KIND_TAGS[] = {'s', 'i', 'e'};
+
+NameDictionary::Names NameDictionary::kinds[(int)NameKind::COUNT];
+int NameDictionary::appendFd = -1;
+string NameDictionary::filename;
+
+/**
+ * Loads the dictionary file and keeps it open for appending new names. The
+ * file is memory-mapped and scanned in place. A missing file is created
+ * empty; until load() is called names are interned in memory only.
+ *
+ * @param path Path to the dictionary file.
+ * @return False if the file could neither be read nor created.
+ */
+bool NameDictionary::load(const string& path) {
+    filename = path;
+    if (appendFd != -1) close(appendFd);
+    appendFd = open(filename.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (appendFd == -1) {
+        cerr << "Error: Unable to open file " << filename << endl;
+        return false;
+    }
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd == -1 || fstat(fd, &st) == -1) {
+        cerr << "Error: Unable to read " << filename << endl;
+        if (fd != -1) close(fd);
+        return false;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return true;
+    }
+
+    void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        cerr << "Error: Unable to map " << filename << endl;
+        return false;
+    }
+
+    // One "<kind> <name>" entry per line; unknown kinds and duplicates are skipped
+    const char* p = static_cast<const char*>(map);
+    const char* end = p + st.st_size;
+    while (p < end) {
+        const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+        if (!eol) eol = end;
+
+        const char* tag = static_cast<const char*>(memchr(KIND_TAGS, *p, sizeof(KIND_TAGS)));
+        if (tag && eol - p > 2 && p[1] == ' ') {
+            Names& names = kinds[tag - KIND_TAGS];
+            string name(p + 2, eol - p - 2);
+            if (!names.ids.count(name)) {
+                names.ids.emplace(name, names.names.size());
+                names.names.push_back(move(name));
+            }
+        }
+        p = eol + 1;
+    }
+
+    // New entries must start on a line of their own
+    bool newline = static_cast<const char*>(map)[st.st_size - 1] == '\n';
+    munmap(map, st.st_size);
+    if (!newline && write(appendFd, "\n", 1) != 1) {
+        cerr << "Error: Unable to write to " << filename << endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Returns the ID of a name, assigning the next free one on first use.
+ *
+ * @param kind Kind of name.
+ * @param name Username or exam name.
+ * @return Dense ID within the kind.
+ */
+uint32_t NameDictionary::intern(NameKind kind, const string& name) {
+    uint32_t id;
+    if (find(kind, name, id)) return id;
+
+    Names& names = kinds[(int)kind];
+    pthread_rwlock_wrlock(&names.lock);
+    auto it = names.ids.find(name);
+    id = (it != names.ids.end()) ? it->second : add(names, name);
+    pthread_rwlock_unlock(&names.lock);
+    return id;
+}
+
+/**
+ * Assigns the next ID and appends the entry. Called with the kind's write lock held.
+ */
+uint32_t NameDictionary::add(Names& names, const string& name) {
+    uint32_t id = names.names.size();
+    names.ids.emplace(name, id);
+    names.names.push_back(name);
+
+    if (appendFd != -1) {
+        string entry = string(1, KIND_TAGS[&names - kinds]) + " " + name + "\n";
+        if (write(appendFd, entry.c_str(), entry.length()) != (ssize_t)entry.length())
+            cerr << "Error: Unable to save name to " << filename << endl;
+    }
+    return id;
+}
+
+/**
+ * Looks up the ID of a name without assigning one.
+ *
+ * @return False if the name has no ID yet.
+ */
+bool NameDictionary::find(NameKind kind, const string& name, uint32_t& id) {
+    Names& names = kinds[(int)kind];
+    pthread_rwlock_rdlock(&names.lock);
+    auto it = names.ids.find(name);
+    bool found = it != names.ids.end();
+    if (found) id = it->second;
+    pthread_rwlock_unlock(&names.lock);
+    return found;
+}
+
+/**
+ * Resolves an ID back to its name.
+ *
+ * @return The name, or an empty string for an unknown ID.
+ */
+string NameDictionary::name(NameKind kind, uint32_t id) {
+    Names& names = kinds[(int)kind];
+    pthread_rwlock_rdlock(&names.lock);
+    string result = id < names.names.size() ? names.names[id] : "";
+    pthread_rwlock_unlock(&names.lock);
+    return result;
+}
+
+/**
+ * Number of IDs assigned in a kind.
+ */
+size_t NameDictionary::size(NameKind kind) {
+    Names& names = kinds[(int)kind];
+    pthread_rwlock_rdlock(&names.lock);
+    size_t n = names.names.size();
+    pthread_rwlock_unlock(&names.lock);
+    return n;
+}
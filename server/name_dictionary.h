@@ -0,0 +1,51 @@
+#ifndef NAME_DICTIONARY_H
+#define NAME_DICTIONARY_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+// Kinds of interned names; each has its own ID space
+enum class NameKind { STUDENT, INSTRUCTOR, EXAM, COUNT };
+
+// Interning dictionary: assigns each student, instructor and exam name a
+// dense uint32 ID (0, 1, 2, ... per kind), so in-memory indexes join on IDs
+// and can be plain arrays. Names are resolved back only for display.
+//
+// The dictionary is an append-only file of "<kind> <name>" lines (s, i or e)
+// and IDs follow line order. The journal and result files still carry names,
+// so losing the file only renumbers the IDs; it is not synced.
+class NameDictionary {
+public:
+    static bool load(const string& filename);
+    static uint32_t intern(NameKind kind, const string& name);
+    static bool find(NameKind kind, const string& name, uint32_t& id);
+    static string name(NameKind kind, uint32_t id);
+    static size_t size(NameKind kind);
+
+private:
+    struct Names {
+        Names() { pthread_rwlock_init(&lock, nullptr); }
+        pthread_rwlock_t lock;
+        unordered_map<string, uint32_t> ids;
+        vector<string> names;                   // ID -> name
+    };
+
+    static Names kinds[(int)NameKind::COUNT];
+    static int appendFd;
+    static string filename;
+
+    static uint32_t add(Names& names, const string& name);
+};
+
+#endif
@@ -0,0 +1,95 @@
+#include "paper_cache.h"
+#include "metrics.h"
+
+list<PaperCache::Entry> PaperCache::lru;
+unordered_map<string, list<PaperCache::Entry>::iterator> PaperCache::index;
+size_t PaperCache::capacity = 64 << 20;
+size_t PaperCache::bytes = 0;
+uint64_t PaperCache::hits = 0;
+uint64_t PaperCache::misses = 0;
+pthread_mutex_t PaperCache::mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Returns the compressed PAPER frame of an exam, compressing it on a miss.
+ *
+ * @param examName Exam whose paper is requested.
+ * @return Encoded PAPER_DEFLATE frame, or nullptr if the exam does not exist
+ *         or its paper does not get smaller (send it uncompressed then).
+ */
+shared_ptr<const string> PaperCache::deflated(const string& examName) {
+    Metrics::lock(&mutex, LockId::PAPER_CACHE);
+    auto it = index.find(examName);
+    if (it != index.end()) {
+        lru.splice(lru.begin(), lru, it->second);
+        shared_ptr<const string> frame = it->second->frame;
+        hits++;
+        pthread_mutex_unlock(&mutex);
+        return frame;
+    }
+    misses++;
+    pthread_mutex_unlock(&mutex);
+
+    // Compress outside the lock; if two threads race, the first one cached wins
+    shared_ptr<const ExamImage> image = ExamImage::get(examName);
+    if (!image) return nullptr;
+    shared_ptr<const string> frame = compress(*image);
+
+    Metrics::lock(&mutex, LockId::PAPER_CACHE);
+    it = index.find(examName);
+    if (it != index.end()) {
+        frame = it->second->frame;
+    } else {
+        lru.push_front({examName, frame});
+        index[examName] = lru.begin();
+        if (frame) bytes += frame->size();
+        evict();
+    }
+    pthread_mutex_unlock(&mutex);
+    return frame;
+}
+
+/**
+ * Sets the byte budget (from paper_cache_mb) and evicts down to it.
+ */
+void PaperCache::setCapacity(size_t limit) {
+    Metrics::lock(&mutex, LockId::PAPER_CACHE);
+    capacity = limit;
+    evict();
+    pthread_mutex_unlock(&mutex);
+}
+
+/**
+ * Returns a consistent snapshot of the cache counters.
+ */
+PaperCacheStats PaperCache::stats() {
+    Metrics::lock(&mutex, LockId::PAPER_CACHE);
+    PaperCacheStats s{lru.size(), bytes, hits, misses};
+    pthread_mutex_unlock(&mutex);
+    return s;
+}
+
+/**
+ * Builds the PAPER_DEFLATE frame of a paper.
+ */
+shared_ptr<const string> PaperCache::compress(const ExamImage& image) {
+    string_view paper = image.paper();
+    string compressed;
+    if (!Compression::deflate(string(paper), compressed) || compressed.size() >= paper.size()) return nullptr;
+
+    auto frame = make_shared<string>(Protocol::encodeHeader(MsgType::PAPER_DEFLATE, compressed.size()));
+    *frame += compressed;
+    return frame;
+}
+
+/**
+ * Drops least recently used papers until the cache fits its budget. Frames
+ * still being sent stay alive through their shared_ptr. Caller holds the mutex.
+ */
+void PaperCache::evict() {
+    while (bytes > capacity && !lru.empty()) {
+        Entry& last = lru.back();
+        if (last.frame) bytes -= last.frame->size();
+        index.erase(last.examName);
+        lru.pop_back();
+    }
+}
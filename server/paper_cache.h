@@ -0,0 +1,53 @@
+#ifndef PAPER_CACHE_H
+#define PAPER_CACHE_H
+
+#include <iostream>
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <cstdint>
+#include <pthread.h>
+
+#include "exam_image.h"
+#include "compression.h"
+#include "protocol.h"
+
+using namespace std;
+
+// Snapshot of cache counters
+struct PaperCacheStats {
+    size_t entries;
+    size_t bytes;
+    uint64_t hits;
+    uint64_t misses;
+};
+
+// LRU of encoded PAPER_DEFLATE frames, bounded by total bytes. A paper is
+// compressed once (at upload, or on its first download) and the same frame
+// is then shared by every student who advertises deflate. The uncompressed
+// paper needs no copy here: it is sent straight from the exam image.
+class PaperCache {
+public:
+    static shared_ptr<const string> deflated(const string& examName);
+    static void setCapacity(size_t bytes);
+    static PaperCacheStats stats();
+
+private:
+    struct Entry {
+        string examName;
+        shared_ptr<const string> frame;     // nullptr if compression does not pay off
+    };
+
+    static list<Entry> lru;                 // most recently used first
+    static unordered_map<string, list<Entry>::iterator> index;
+    static size_t capacity;
+    static size_t bytes;
+    static uint64_t hits, misses;
+    static pthread_mutex_t mutex;
+
+    static shared_ptr<const string> compress(const ExamImage& image);
+    static void evict();
+};
+
+#endif
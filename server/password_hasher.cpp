@@ -0,0 +1,126 @@
+#include "password_hasher.h"
+#include "config.h"
+
+#define SALT_BYTES 16
+#define KEY_BYTES 32
+
+/**
+ * Cost parameters for new hashes, from the server configuration.
+ */
+KdfParams PasswordHasher::currentParams() {
+    return {ServerConfig::kdfLogN, ServerConfig::kdfR, ServerConfig::kdfP};
+}
+
+/**
+ * Hashes a password with a fresh random salt and the configured cost.
+ *
+ * @param password Plaintext password.
+ * @return Encoded hash (no whitespace, safe for the user files), or an empty
+ *         string if the KDF failed.
+ */
+string PasswordHasher::hash(const string& password) {
+    KdfParams params = currentParams();
+    string salt(SALT_BYTES, '\0'), key;
+    if (RAND_bytes(reinterpret_cast<unsigned char*>(&salt[0]), SALT_BYTES) != 1 ||
+        !derive(password, salt, params, key)) {
+        cerr << "Error: password hashing failed" << endl;
+        return "";
+    }
+
+    ostringstream out;
+    out << "$scrypt$ln=" << params.logN << ",r=" << params.r << ",p=" << params.p
+        << "$" << encodeBase64(salt) << "$" << encodeBase64(key);
+    return out.str();
+}
+
+/**
+ * Checks a password against a stored hash, using the hash's own parameters.
+ *
+ * @param password Plaintext password.
+ * @param stored Encoded scrypt hash, or a legacy decimal hash.
+ * @return True if the password matches.
+ */
+bool PasswordHasher::verify(const string& password, const string& stored) {
+    if (stored.empty() || stored[0] != '$') return stored == legacyHash(password);
+
+    KdfParams params;
+    string salt, expected, key;
+    if (!parse(stored, params, salt, expected) || !derive(password, salt, params, key)) return false;
+    return key.size() == expected.size() && CRYPTO_memcmp(key.data(), expected.data(), key.size()) == 0;
+}
+
+/**
+ * True if a stored hash was not made with the current scheme and cost.
+ */
+bool PasswordHasher::needsRehash(const string& stored) {
+    KdfParams params, now = currentParams();
+    string salt, key;
+    if (!parse(stored, params, salt, key)) return true;
+    return params.logN != now.logN || params.r != now.r || params.p != now.p;
+}
+
+/**
+ * Splits "$scrypt$ln=..,r=..,p=..$salt$key" into its parts.
+ */
+bool PasswordHasher::parse(const string& stored, KdfParams& params, string& salt, string& key) {
+    const string prefix = "$scrypt$";
+    if (stored.compare(0, prefix.size(), prefix) != 0) return false;
+
+    size_t saltPos = stored.find('$', prefix.size());
+    if (saltPos == string::npos) return false;
+    size_t keyPos = stored.find('$', saltPos + 1);
+    if (keyPos == string::npos) return false;
+
+    string settings = stored.substr(prefix.size(), saltPos - prefix.size());
+    if (sscanf(settings.c_str(), "ln=%d,r=%d,p=%d", &params.logN, &params.r, &params.p) != 3) return false;
+    if (params.logN < 1 || params.logN > 30 || params.r < 1 || params.p < 1) return false;
+
+    return decodeBase64(stored.substr(saltPos + 1, keyPos - saltPos - 1), salt) &&
+           decodeBase64(stored.substr(keyPos + 1), key);
+}
+
+/**
+ * Runs scrypt. This is the expensive part: tens of milliseconds and
+ * 128 * r * 2^logN bytes of memory per call.
+ */
+bool PasswordHasher::derive(const string& password, const string& salt, const KdfParams& params, string& key) {
+    uint64_t n = 1ULL << params.logN;
+    uint64_t maxMem = 2 * 128ULL * params.r * n * params.p + (1 << 20);
+    key.assign(KEY_BYTES, '\0');
+    return EVP_PBE_scrypt(password.data(), password.size(),
+                          reinterpret_cast<const unsigned char*>(salt.data()), salt.size(),
+                          n, params.r, params.p, maxMem,
+                          reinterpret_cast<unsigned char*>(&key[0]), key.size()) == 1;
+}
+
+string PasswordHasher::encodeBase64(const string& data) {
+    string out(4 * ((data.size() + 2) / 3) + 1, '\0');
+    int len = EVP_EncodeBlock(reinterpret_cast<unsigned char*>(&out[0]),
+                              reinterpret_cast<const unsigned char*>(data.data()), data.size());
+    out.resize(len);
+    return out;
+}
+
+bool PasswordHasher::decodeBase64(const string& text, string& out) {
+    if (text.empty() || text.size() % 4 != 0) return false;
+
+    out.assign(3 * text.size() / 4 + 1, '\0');
+    int len = EVP_DecodeBlock(reinterpret_cast<unsigned char*>(&out[0]),
+                              reinterpret_cast<const unsigned char*>(text.data()), text.size());
+    if (len < 0) return false;
+
+    // EVP_DecodeBlock counts the '=' padding as zero bytes
+    size_t padding = 0;
+    for (size_t i = text.size(); i > 0 && text[i - 1] == '='; --i) padding++;
+    out.resize(len - padding);
+    return true;
+}
+
+/**
+ * The hash used before scrypt (std::hash, decimal). Kept only to verify old
+ * entries so they can be upgraded.
+ */
+string PasswordHasher::legacyHash(const string& password) {
+    std::hash<string> hasher;
+    return to_string(hasher(password));
+}
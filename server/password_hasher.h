@@ -0,0 +1,45 @@
+#ifndef PASSWORD_HASHER_H
+#define PASSWORD_HASHER_H
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <openssl/evp.h>
+#include <openssl/kdf.h>
+#include <openssl/rand.h>
+#include <openssl/crypto.h>
+
+using namespace std;
+
+// Cost parameters of the scrypt KDF (N = 2^logN, memory = 128 * r * N bytes)
+struct KdfParams {
+    int logN;
+    int r;
+    int p;
+};
+
+// Password hashing with scrypt. Stored hashes carry their own parameters,
+//   $scrypt$ln=<logN>,r=<r>,p=<p>$<base64 salt>$<base64 key>
+// so the cost can be retuned without resetting existing passwords: they are
+// verified with the parameters they were made with and rehashed on the next
+// successful login. Hashes from before this scheme (decimal std::hash
+// values) are accepted the same way.
+class PasswordHasher {
+public:
+    static string hash(const string& password);
+    static bool verify(const string& password, const string& stored);
+    static bool needsRehash(const string& stored);
+    static KdfParams currentParams();
+
+private:
+    static bool parse(const string& stored, KdfParams& params, string& salt, string& key);
+    static bool derive(const string& password, const string& salt, const KdfParams& params, string& key);
+    static string encodeBase64(const string& data);
+    static bool decodeBase64(const string& text, string& out);
+    static string legacyHash(const string& password);
+};
+
+#endif
@@ -0,0 +1,496 @@
+#include "reactor.h"
+
+#define MAX_EVENTS 256
+
+// epoll user data for the two non-client descriptors; client ids start above
+#define LISTEN_ID 0
+#define WAKE_ID 1
+
+/**
+ * Creates the epoll instance and registers the (non-blocking) listening socket
+ * and the eventfd workers use to hand finished jobs back to the loop.
+ *
+ * @param listen_fd Listening socket returned by socket()/bind()/listen().
+ * @param workers Pool that runs offloaded session jobs.
+ */
+Reactor::Reactor(int listen_fd, WorkerPool& workers)
+    : listen_fd(listen_fd), nextId(WAKE_ID + 1), workers(workers), tickIntervalMs(0) {
+    epoll_fd = epoll_create1(0);
+    wake_fd = eventfd(0, EFD_NONBLOCK);
+    if (epoll_fd == -1 || wake_fd == -1) {
+        cerr << "Error: Could not create epoll instance\n";
+        exit(EXIT_FAILURE);
+    }
+    pthread_mutex_init(&completedMutex, nullptr);
+
+    // sendfile() has no MSG_NOSIGNAL; a peer that went away must not kill the server
+    signal(SIGPIPE, SIG_IGN);
+
+    setNonBlocking(listen_fd);
+
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.u64 = LISTEN_ID;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev) == -1) {
+        cerr << "Error: Could not register listening socket\n";
+        exit(EXIT_FAILURE);
+    }
+
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.u64 = WAKE_ID;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &ev) == -1) {
+        cerr << "Error: Could not register wakeup descriptor\n";
+        exit(EXIT_FAILURE);
+    }
+}
+
+Reactor::~Reactor() {
+    for (auto& [id, conn] : connections) {
+        if (!conn->detached) close(conn->fd);
+        delete conn;
+    }
+    pthread_mutex_destroy(&completedMutex);
+    close(wake_fd);
+    close(epoll_fd);
+}
+
+/**
+ * Switches a descriptor to non-blocking mode.
+ *
+ * @param fd Descriptor to modify.
+ * @return True on success, false otherwise.
+ */
+bool Reactor::setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags == -1) return false;
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+
+/**
+ * Registers a callback run on the loop thread every intervalMs milliseconds.
+ *
+ * @param intervalMs Period in milliseconds.
+ * @param callback Function to run.
+ */
+void Reactor::setTick(int intervalMs, function<void()> callback) {
+    tickIntervalMs = intervalMs;
+    tick = move(callback);
+    nextTick = chrono::steady_clock::now() + chrono::milliseconds(intervalMs);
+}
+
+/**
+ * Runs the event loop forever: accepts clients, decodes frames from readable
+ * sockets into their sessions, resumes sessions whose jobs finished and
+ * flushes pending output.
+ */
+void Reactor::run() {
+    epoll_event events[MAX_EVENTS];
+
+    while (true) {
+        int n = epoll_wait(epoll_fd, events, MAX_EVENTS, nextTimeoutMs());
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            cerr << "Error: epoll_wait failed\n";
+            return;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            uint64_t id = events[i].data.u64;
+
+            // New connections on the listening socket
+            if (id == LISTEN_ID) {
+                acceptConnections();
+                continue;
+            }
+            // Workers finished one or more jobs
+            if (id == WAKE_ID) {
+                drainCompleted();
+                continue;
+            }
+
+            auto it = connections.find(id);
+            if (it == connections.end()) continue;
+            Connection* conn = it->second;
+
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                handleRead(conn);
+            }
+            if (events[i].events & EPOLLOUT) {
+                flush(conn);
+            }
+            reap(conn);
+        }
+
+        if (tickIntervalMs > 0 && chrono::steady_clock::now() >= nextTick) {
+            tick();
+            nextTick = chrono::steady_clock::now() + chrono::milliseconds(tickIntervalMs);
+        }
+    }
+}
+
+/**
+ * Accepts every pending connection (edge-triggered, so until EAGAIN) and
+ * registers each one for read/write readiness.
+ */
+void Reactor::acceptConnections() {
+    while (true) {
+        int client_fd = accept(listen_fd, nullptr, nullptr);
+        if (client_fd == -1) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                cerr << "Error: accept failed\n";
+            return;
+        }
+
+        setNonBlocking(client_fd);
+
+        uint64_t id = nextId++;
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.u64 = id;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_fd, &ev) == -1) {
+            cerr << "Error: Could not register client socket\n";
+            close(client_fd);
+            continue;
+        }
+
+        connections[id] = new Connection(id, client_fd, this);
+        Metrics::sessionOpened();
+    }
+}
+
+/**
+ * Drains a readable socket until EAGAIN and feeds every complete frame to the
+ * session. While a worker holds the session frames are parked until it returns.
+ * Frames that arrived together with the peer's FIN (a last submit followed by
+ * close) are still handled; the connection closes once they are answered.
+ *
+ * @param conn Connection that became readable.
+ */
+void Reactor::handleRead(Connection* conn) {
+    char buffer[4096];
+    bool peerClosed = false, failed = false;
+
+    while (true) {
+        ssize_t bytes = recv(conn->fd, buffer, sizeof(buffer), 0);
+        if (bytes > 0) {
+            conn->inbuf.append(buffer, bytes);
+            continue;
+        }
+        if (bytes == 0) {
+            peerClosed = true;
+            break;
+        }
+        if (errno == EINTR) continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK) failed = true;
+        break;
+    }
+
+    if (failed) conn->broken = true;
+
+    Frame frame;
+    while (!conn->closeAfterFlush && !conn->broken) {
+        int status = Protocol::decode(conn->inbuf, frame);
+        if (status == 0) break;
+        if (status < 0) {
+            cerr << "Error: Frame larger than " << Protocol::maxPayload << " bytes, closing connection\n";
+            conn->broken = true;
+            break;
+        }
+        dispatch(conn, frame);
+    }
+    if (peerClosed) conn->closeAfterFlush = true;
+}
+
+/**
+ * Hands one frame to the session, or parks it while a worker holds the session.
+ *
+ * @param conn Connection the frame arrived on.
+ * @param frame Decoded frame.
+ */
+void Reactor::dispatch(Connection* conn, const Frame& frame) {
+    if (conn->session.busy) {
+        conn->session.pending.push_back(frame);
+        return;
+    }
+
+    conn->session.onMessage(frame);
+    if (!conn->session.busy && conn->session.state == SessionState::CLOSED)
+        conn->closeAfterFlush = true;
+}
+
+/**
+ * Queues output for a connection and tries to write it right away.
+ * Must be called on the loop thread.
+ *
+ * @param id Connection id.
+ * @param chunk Frame produced by Protocol::encode(), or a file range.
+ */
+void Reactor::queue(uint64_t id, OutChunk chunk) {
+    auto it = connections.find(id);
+    if (it == connections.end() || it->second->broken) return;
+    Connection* conn = it->second;
+
+    conn->outq.push_back(move(chunk));
+    flush(conn);
+}
+
+/**
+ * Hands a job for a session to the worker pool. The session is marked busy
+ * so the loop leaves it alone until the job has been posted back. The loop
+ * never waits for a full pool: with the QUEUE policy the job is parked (its
+ * session stays busy, so later frames wait too) and resubmitted as workers
+ * finish.
+ *
+ * @param id Connection id.
+ * @param job Work to run against the session on a worker thread.
+ * @param pool Pool to run it on; defaults to the general worker pool.
+ * @return False if the pool rejected the job (overload).
+ */
+bool Reactor::submit(uint64_t id, function<void(Session&)> job, WorkerPool* pool) {
+    auto it = connections.find(id);
+    if (it == connections.end()) return false;
+    Session* session = &it->second->session;
+    WorkerPool& target = pool ? *pool : workers;
+
+    // Jobs already parked for this pool go first
+    bool waiting = false;
+    for (const ParkedJob& p : parked) waiting = waiting || p.pool == &target;
+
+    session->busy = true;
+    if (!waiting && target.submit(task(id, session, job), false)) return true;
+    if (target.getPolicy() != OverloadPolicy::QUEUE) {
+        session->busy = false;
+        return false;
+    }
+    parked.push_back({id, move(job), &target});
+    return true;
+}
+
+/**
+ * Wraps a session job into a pool task that posts the session back to the
+ * loop when done.
+ */
+function<void()> Reactor::task(uint64_t id, Session* session, function<void(Session&)> job) {
+    return [this, id, session, job]() {
+        job(*session);
+
+        pthread_mutex_lock(&completedMutex);
+        completed.push_back(id);
+        pthread_mutex_unlock(&completedMutex);
+
+        uint64_t one = 1;
+        write(wake_fd, &one, sizeof(one));
+    };
+}
+
+/**
+ * Resubmits parked jobs, oldest first, until their pools are full again.
+ * A job whose connection closed meanwhile still runs (the session is kept
+ * detached until it is posted back), like a job that was already queued.
+ */
+void Reactor::retryParked() {
+    vector<WorkerPool*> full;
+    for (auto it = parked.begin(); it != parked.end();) {
+        if (find(full.begin(), full.end(), it->pool) != full.end()) {
+            ++it;
+            continue;
+        }
+        auto conn = connections.find(it->id);
+        if (conn == connections.end()) {
+            it = parked.erase(it);
+        } else if (it->pool->submit(task(it->id, &conn->second->session, it->job), false)) {
+            it = parked.erase(it);
+        } else {
+            full.push_back(it->pool);
+            ++it;
+        }
+    }
+}
+
+/**
+ * Runs a callback against a session on the loop thread. Safe to call from
+ * any thread; the callback is dropped if the connection is gone by then.
+ *
+ * @param id Connection id.
+ * @param callback Work to run against the session (typically a reply).
+ */
+void Reactor::post(uint64_t id, function<void(Session&)> callback) {
+    pthread_mutex_lock(&completedMutex);
+    postedCallbacks.push_back({id, move(callback)});
+    pthread_mutex_unlock(&completedMutex);
+
+    uint64_t one = 1;
+    write(wake_fd, &one, sizeof(one));
+}
+
+/**
+ * Resumes every session whose job was finished by a worker and runs the
+ * callbacks posted by other threads.
+ */
+void Reactor::drainCompleted() {
+    uint64_t counter;
+    while (read(wake_fd, &counter, sizeof(counter)) > 0) {}
+
+    deque<uint64_t> done;
+    deque<pair<uint64_t, function<void(Session&)>>> callbacks;
+    pthread_mutex_lock(&completedMutex);
+    done.swap(completed);
+    callbacks.swap(postedCallbacks);
+    pthread_mutex_unlock(&completedMutex);
+
+    // Finished jobs freed pool slots
+    retryParked();
+
+    for (uint64_t id : done) {
+        auto it = connections.find(id);
+        if (it == connections.end()) continue;
+        resume(it->second);
+    }
+
+    for (auto& [id, callback] : callbacks) {
+        auto it = connections.find(id);
+        if (it == connections.end() || it->second->detached) continue;
+        it->second->posted.push_back(move(callback));
+        if (!it->second->session.busy) runPosted(it->second);
+    }
+}
+
+/**
+ * Runs the callbacks posted for an idle session, then closes the connection
+ * if the session ended.
+ *
+ * @param conn Connection whose session is not held by a worker.
+ */
+void Reactor::runPosted(Connection* conn) {
+    Session& session = conn->session;
+    while (!session.busy && !conn->posted.empty()) {
+        function<void(Session&)> callback = move(conn->posted.front());
+        conn->posted.pop_front();
+        callback(session);
+    }
+
+    if (!session.busy && session.state == SessionState::CLOSED) conn->closeAfterFlush = true;
+    reap(conn);
+}
+
+/**
+ * Sends the replies a job produced and feeds the session any frames that
+ * arrived meanwhile. Connections closed during the job are freed here.
+ *
+ * @param conn Connection whose job finished.
+ */
+void Reactor::resume(Connection* conn) {
+    Session& session = conn->session;
+    session.busy = false;
+
+    if (conn->detached) {
+        if (!session.username.empty())
+            cout << "[-] client[ " << session.username << " ] disconnected!" << endl;
+        connections.erase(conn->id);
+        delete conn;
+        return;
+    }
+
+    for (OutChunk& chunk : session.deferred) queue(conn->id, move(chunk));
+    session.deferred.clear();
+
+    while (!session.busy && !conn->posted.empty()) {
+        function<void(Session&)> callback = move(conn->posted.front());
+        conn->posted.pop_front();
+        callback(session);
+    }
+
+    while (!session.busy && !session.pending.empty() && session.state != SessionState::CLOSED) {
+        Frame frame = move(session.pending.front());
+        session.pending.pop_front();
+        session.onMessage(frame);
+    }
+
+    if (!session.busy && session.state == SessionState::CLOSED) conn->closeAfterFlush = true;
+    reap(conn);
+}
+
+/**
+ * Writes as much queued output as the socket accepts; the rest goes out on
+ * the next EPOLLOUT.
+ *
+ * @param conn Connection to flush.
+ */
+void Reactor::flush(Connection* conn) {
+    while (!conn->outq.empty()) {
+        OutChunk& chunk = conn->outq.front();
+
+        // File ranges go from the page cache to the socket without a user-space copy
+        ssize_t sent;
+        if (chunk.file.fd != -1) {
+            off_t position = chunk.file.offset + chunk.offset;
+            sent = sendfile(conn->fd, chunk.file.fd, &position, chunk.file.length - chunk.offset);
+        } else {
+            const string& bytes = chunk.bytes();
+            sent = send(conn->fd, bytes.data() + chunk.offset, bytes.size() - chunk.offset, MSG_NOSIGNAL);
+        }
+        if (sent == -1) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return;  // wait for EPOLLOUT
+            conn->broken = true;
+            conn->outq.clear();
+            break;
+        }
+
+        chunk.offset += sent;
+        if (chunk.offset == chunk.size()) conn->outq.pop_front();
+    }
+}
+
+/**
+ * Closes a connection once it is broken, or finished, fully flushed and not
+ * waiting for a job. Only called from the event loop.
+ *
+ * @param conn Connection to check.
+ * @return True if the connection was closed.
+ */
+bool Reactor::reap(Connection* conn) {
+    if (conn->detached) return false;
+    if (conn->broken || (conn->closeAfterFlush && conn->outq.empty() && !conn->session.busy)) {
+        closeConnection(conn);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Computes how long epoll_wait may sleep before the next tick is due.
+ *
+ * @return Timeout in milliseconds, or -1 to wait indefinitely.
+ */
+int Reactor::nextTimeoutMs() {
+    if (tickIntervalMs <= 0) return -1;
+    auto now = chrono::steady_clock::now();
+    if (nextTick <= now) return 0;
+    return chrono::duration_cast<chrono::milliseconds>(nextTick - now).count() + 1;
+}
+
+/**
+ * Unregisters and closes a connection. If a worker still holds its session
+ * the object is kept (detached) until the job is posted back.
+ *
+ * @param conn Connection to close.
+ */
+void Reactor::closeConnection(Connection* conn) {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn->fd, nullptr);
+    close(conn->fd);
+    Metrics::sessionClosed();
+
+    if (conn->session.busy) {
+        conn->detached = true;
+        conn->broken = true;
+        conn->outq.clear();
+        return;
+    }
+
+    if (!conn->session.username.empty())
+        cout << "[-] client[ " << conn->session.username << " ] disconnected!" << endl;
+    connections.erase(conn->id);
+    delete conn;
+}
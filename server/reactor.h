@@ -0,0 +1,98 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <iostream>
+#include <string>
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <csignal>
+#include <pthread.h>
+
+#include "session.h"
+#include "metrics.h"
+#include "worker_pool.h"
+
+using namespace std;
+
+// Per-connection state owned by the reactor: socket, buffers and session
+struct Connection {
+    uint64_t id;
+    int fd;
+    bool closeAfterFlush;
+    bool broken;          // peer went away, a write failed or a frame was malformed
+    bool detached;        // socket closed while a worker still holds the session
+    string inbuf;         // received bytes not yet forming a complete frame
+    deque<OutChunk> outq;
+    deque<function<void(Session&)>> posted;   // callbacks waiting for the worker to hand the session back
+    Session session;
+    Connection(uint64_t id, int fd, Reactor* reactor)
+        : id(id), fd(fd), closeAfterFlush(false), broken(false), detached(false), session(id, fd, reactor) {}
+};
+
+// Edge-triggered epoll event loop driving every client connection on one thread.
+// Slow work is handed to a WorkerPool and its result posted back to the loop.
+class Reactor {
+public:
+    Reactor(int listen_fd, WorkerPool& workers);
+    ~Reactor();
+    void run();
+    void queue(uint64_t id, OutChunk chunk);
+    bool submit(uint64_t id, function<void(Session&)> job, WorkerPool* pool = nullptr);
+    void post(uint64_t id, function<void(Session&)> callback);
+    void setTick(int intervalMs, function<void()> tick);
+
+private:
+    int epoll_fd;
+    int listen_fd;
+    int wake_fd;                  // eventfd signalled when workers finish a job
+    uint64_t nextId;
+    WorkerPool& workers;
+    unordered_map<uint64_t, Connection*> connections;
+
+    // Jobs finished by workers, waiting to be resumed on the loop thread, and
+    // callbacks posted from other threads (e.g. journal commits)
+    pthread_mutex_t completedMutex;
+    deque<uint64_t> completed;
+    deque<pair<uint64_t, function<void(Session&)>>> postedCallbacks;
+
+    // Jobs for QUEUE pools that were full, in arrival order; resubmitted as
+    // workers finish instead of blocking the loop
+    struct ParkedJob {
+        uint64_t id;
+        function<void(Session&)> job;
+        WorkerPool* pool;
+    };
+    deque<ParkedJob> parked;
+
+    int tickIntervalMs;
+    function<void()> tick;
+    chrono::steady_clock::time_point nextTick;
+
+    static bool setNonBlocking(int fd);
+    void acceptConnections();
+    void handleRead(Connection* conn);
+    void dispatch(Connection* conn, const Frame& frame);
+    void flush(Connection* conn);
+    void drainCompleted();
+    function<void()> task(uint64_t id, Session* session, function<void(Session&)> job);
+    void retryParked();
+    void resume(Connection* conn);
+    void runPosted(Connection* conn);
+    bool reap(Connection* conn);
+    void closeConnection(Connection* conn);
+    int nextTimeoutMs();
+};
+
+#endif
@@ -0,0 +1,134 @@
+#include "result_writer.h"
+#include "exam_stats.h"
+
+ResultWriter::ResultWriter(size_t maxBatch)
+    : maxBatch(maxBatch ? maxBatch : 1), head(new Node()), pushed(0), written(0), flushes(0),
+      largestBatch(0), running(false), stopping(false), idle(false) {
+    tail = head.load();
+    tail->next.store(nullptr);
+    pthread_mutex_init(&mutex, nullptr);
+    pthread_cond_init(&wake, nullptr);
+}
+
+/**
+ * Writes out everything still queued, then stops the writer thread.
+ */
+ResultWriter::~ResultWriter() {
+    if (running) {
+        pthread_mutex_lock(&mutex);
+        stopping.store(true);
+        pthread_cond_signal(&wake);
+        pthread_mutex_unlock(&mutex);
+        pthread_join(writer, nullptr);
+    }
+
+    Submission leftover;
+    while (pop(leftover)) {}
+    delete tail;
+    pthread_mutex_destroy(&mutex);
+    pthread_cond_destroy(&wake);
+}
+
+bool ResultWriter::start() {
+    if (pthread_create(&writer, nullptr, writerMain, this) != 0) {
+        cerr << "Error: Could not start the result writer thread" << endl;
+        return false;
+    }
+    running = true;
+    return true;
+}
+
+/**
+ * Queues a committed submission for the result files. Never blocks on the
+ * writer; the lock is only taken to wake it when it is asleep.
+ *
+ * @param submission Graded, journaled submission; not changed afterwards.
+ */
+void ResultWriter::push(Submission submission) {
+    Node* node = new Node();
+    node->next.store(nullptr, memory_order_relaxed);
+    node->submission = move(submission);
+
+    Node* prev = head.exchange(node, memory_order_acq_rel);
+    prev->next.store(node, memory_order_release);
+    pushed.fetch_add(1, memory_order_relaxed);
+
+    // Pairs with the fence in runWriter(): the link above must be visible
+    // before idle is read, or both sides could miss each other
+    atomic_thread_fence(memory_order_seq_cst);
+    if (idle.load()) {
+        pthread_mutex_lock(&mutex);
+        pthread_cond_signal(&wake);
+        pthread_mutex_unlock(&mutex);
+    }
+}
+
+/**
+ * Takes the oldest queued submission. Writer thread only.
+ *
+ * @return False if the queue is empty (or a push is half done).
+ */
+bool ResultWriter::pop(Submission& submission) {
+    Node* next = tail->next.load(memory_order_acquire);
+    if (!next) return false;
+
+    submission = move(next->submission);
+    delete tail;
+    tail = next;        // the popped node becomes the new placeholder
+    return true;
+}
+
+ResultWriterStats ResultWriter::stats() const {
+    uint64_t in = pushed.load(memory_order_relaxed), out = written.load(memory_order_relaxed);
+    return {out, flushes.load(memory_order_relaxed), largestBatch.load(memory_order_relaxed), in > out ? in - out : 0};
+}
+
+void* ResultWriter::writerMain(void* arg) {
+    static_cast<ResultWriter*>(arg)->runWriter();
+    return nullptr;
+}
+
+/**
+ * Writer loop: drains up to maxBatch submissions at a time and sleeps when
+ * the queue is empty.
+ */
+void ResultWriter::runWriter() {
+    vector<Submission> batch;
+    while (true) {
+        Submission submission;
+        while (batch.size() < maxBatch && pop(submission)) batch.push_back(move(submission));
+        if (!batch.empty()) {
+            flush(batch);
+            batch.clear();
+            continue;
+        }
+        if (stopping.load()) return;
+
+        // Announce the sleep before checking once more, so a push racing with
+        // it either is seen here or sees idle and signals
+        pthread_mutex_lock(&mutex);
+        idle.store(true);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (!tail->next.load(memory_order_acquire) && !stopping.load()) pthread_cond_wait(&wake, &mutex);
+        idle.store(false);
+        pthread_mutex_unlock(&mutex);
+    }
+}
+
+/**
+ * Appends a batch to the result files and saves the totals of every exam in it.
+ */
+void ResultWriter::flush(const vector<Submission>& batch) {
+    auto started = chrono::steady_clock::now();
+
+    ResultViews::apply(batch);
+    set<string> exams;
+    for (const Submission& s : batch) {
+        if (exams.insert(s.examName).second) ExamStats::forExam(s.examName, s.answers.size())->save();
+    }
+
+    flushTimes.record(chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - started).count());
+    written.fetch_add(batch.size(), memory_order_relaxed);
+    flushes.fetch_add(1, memory_order_relaxed);
+    if (batch.size() > largestBatch.load(memory_order_relaxed)) largestBatch.store(batch.size(), memory_order_relaxed);
+}
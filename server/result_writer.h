@@ -0,0 +1,69 @@
+#ifndef RESULT_WRITER_H
+#define RESULT_WRITER_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <set>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <pthread.h>
+
+#include "submission.h"
+#include "metrics.h"
+
+using namespace std;
+
+// Snapshot of result writer counters
+struct ResultWriterStats {
+    uint64_t written;           // submissions written to the result files
+    uint64_t flushes;           // batches written
+    uint64_t maxBatch;          // most submissions in one batch
+    uint64_t queued;            // submissions waiting for the writer
+};
+
+// Write-behind stage for the result files. Committed submissions are pushed
+// onto a lock-free multi-producer queue and a single writer thread takes
+// whatever has piled up, appends it to the per-student, per-exam and log
+// files (ResultViews) and saves the exam analysis totals. Acknowledgements
+// only wait for the journal; the files are rebuilt from it on restart, so
+// nothing is lost if the server stops before the writer catches up.
+class ResultWriter {
+public:
+    explicit ResultWriter(size_t maxBatch);
+    ~ResultWriter();
+
+    bool start();
+    void push(Submission submission);
+    ResultWriterStats stats() const;
+    const LatencyHistogram& flushHistogram() const { return flushTimes; }
+
+private:
+    // Intrusive MPSC queue node (Vyukov): producers swap themselves in at
+    // head, the writer follows next pointers from tail
+    struct Node {
+        atomic<Node*> next;
+        Submission submission;
+    };
+
+    size_t maxBatch;
+    atomic<Node*> head;
+    Node* tail;
+    atomic<uint64_t> pushed, written, flushes, largestBatch;
+    LatencyHistogram flushTimes;
+
+    pthread_t writer;
+    bool running;
+    atomic<bool> stopping;
+    atomic<bool> idle;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+
+    bool pop(Submission& submission);
+    void flush(const vector<Submission>& batch);
+    static void* writerMain(void* arg);
+    void runWriter();
+};
+
+#endif
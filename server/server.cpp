@@ -1,13 +1,22 @@
 #include "server.h"
+#include "reactor.h"
+#include "config.h"
+#include "journal.h"
+#include "submission.h"
+#include "exam_stats.h"
+#include "leaderboard.h"
+#include "metrics.h"
+#include "session_tokens.h"
+#include "paper_cache.h"
+#include "exam_seal.h"
+#include "answer_sheet.h"
+#include "result_writer.h"
+#include "attempt_index.h"
 #include <cctype>
-#define INT_MIN -1000
+constexpr int NO_SCORE = -1000;
 
-static vector<string> exams;
-map<int, string> Server::socketToUsername;
-
-pthread_mutex_t file_mutex1 = PTHREAD_MUTEX_INITIALIZER; // global variables
-pthread_mutex_t file_mutex2 = PTHREAD_MUTEX_INITIALIZER; // exam log file
-pthread_mutex_t file_mutex3 = PTHREAD_MUTEX_INITIALIZER; // analysis file
+static Journal* journal = nullptr;       // submission journal; result files are derived from it
+WorkerPool* Server::hashPool = nullptr;   // password hashing (scrypt) pool for logins and registrations
 
 // Constructor to initialize and start the server on the specified port
 Server::Server(int port) {
@@ -18,6 +27,10 @@ Server::Server(int port) {
         exit(EXIT_FAILURE);
     }
 
+    // Allow quick restarts while old connections sit in TIME_WAIT
+    int reuse = 1;
+    setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
     // Define server address structure and zero-initialize
     sockaddr_in server_addr{};
     server_addr.sin_family = AF_INET;            // IPv4
@@ -30,8 +43,8 @@ Server::Server(int port) {
         exit(EXIT_FAILURE);
     }
 
-    // Start listening for incoming connections (backlog size 5)
-    if (listen(server_socket, 5) == -1) {
+    // Start listening; a scheduled exam start brings thousands of connects at once
+    if (listen(server_socket, SOMAXCONN) == -1) {
         cerr << "Error: Could not listen for connections\n";
         exit(EXIT_FAILURE);
     }
@@ -40,157 +53,233 @@ Server::Server(int port) {
 }
 
 
+// Folds journaled submissions into the per-exam leaderboards, the attempt
+// index and the analysis aggregates, and optionally saves every exam whose
+// aggregates changed (otherwise the result writer does). Records already
+// covered by an exam's saved totals (LSN at or below the one stored with them)
+// are not counted again.
+static void recordAnalysis(uint64_t firstLsn, const vector<string>& records, bool save) {
+    map<string, shared_ptr<ExamStats>> touched;
+    for (size_t i = 0; i < records.size(); ++i) {
+        Submission sub;
+        if (!Submission::decode(records[i], sub)) continue;
+
+        uint64_t lsn = firstLsn + i;
+        Leaderboard::forExam(sub.examName)->add(sub, lsn);
+        AttemptIndex::add(sub, lsn);
+
+        shared_ptr<ExamStats> stats = ExamStats::forExam(sub.examName, sub.answers.size());
+        if (lsn <= stats->appliedLsn()) continue;
+        stats->record(sub, lsn);
+        touched[sub.examName] = stats;
+    }
+    if (save) {
+        for (auto& [name, stats] : touched) stats->save();
+    }
+}
+
 // Starts the server loop to handle incoming client connections
 void Server::start() {
+    // Dense IDs of students, instructors and exams used by the in-memory indexes
+    if (!NameDictionary::load("../data/names.dict")) exit(EXIT_FAILURE);
+
     // Initialize the authentication manager (e.g., load user credentials)
     AuthManager();
 
     // Create an instance of ExamManager
     ExamManager em;
 
-    // Load exam metadata from file into the exams list
-    exams = em.load_exam_metadata("../data/exams/exam_list.txt");
-
-    // Start an infinite loop to accept and handle incoming client connections
-    while (true) {
-        // Accept a new client connection
-        int client_socket = accept(server_socket, nullptr, nullptr);
-
-        // Create a new thread to handle the client
-        pthread_t thread;
-        pthread_create(&thread, nullptr, handle_client, &client_socket);
-
-        // Detach the thread so that resources are automatically reclaimed when it exits
-        pthread_detach(thread);
+    // Exams uploaded before compiled images existed get one now
+    em.compile_missing_images("../data/exams/exam_list.txt");
+
+    // Load exam metadata from file into the catalog (with each paper's hash)
+    ExamCatalog::load(em.load_exam_entries("../data/exams/exam_list.txt"));
+
+    // Frames announcing a bigger payload are treated as a protocol error
+    Protocol::maxPayload = ServerConfig::maxPayloadBytes;
+
+    // Replay the submission journal and regenerate the result files from it.
+    // From here on committed submissions go to the result writer, which
+    // appends them to those files behind the acknowledgements.
+    mkdir("../data/results", 0755);
+    ResultWriter results(ServerConfig::journalMaxBatch);
+    Journal submissions(ServerConfig::journalPath, ServerConfig::journalMaxBatch);
+    vector<string> records;
+    if (!submissions.open(records)) exit(EXIT_FAILURE);
+
+    // A new journal first takes in the attempts of the result files written
+    // before it existed, so the rebuild below keeps them
+    if (records.empty()) {
+        vector<string> legacy;
+        for (const Submission& sub : ResultViews::readLegacy()) legacy.push_back(sub.encode());
+        if (!legacy.empty()) {
+            if (!submissions.import(legacy)) exit(EXIT_FAILURE);
+            records = move(legacy);
+            cout << "[+] imported " << records.size() << " attempts from pre-journal result files" << endl;
+        }
     }
+    vector<Submission> replayed;
+    for (const string& record : records) {
+        Submission sub;
+        if (Submission::decode(record, sub)) replayed.push_back(move(sub));
+        else cerr << "Warning: skipping malformed journal record" << endl;
+    }
+    ResultViews::rebuild(replayed);
+    recordAnalysis(1, records, true);
+    if (!results.start()) exit(EXIT_FAILURE);
+    submissions.setApplier([&results](uint64_t firstLsn, const vector<string>& batch) {
+        // Leaderboards and totals are updated in memory before the acks; the
+        // files follow on the writer thread
+        recordAnalysis(firstLsn, batch, false);
+        for (const string& record : batch) {
+            Submission sub;
+            if (Submission::decode(record, sub)) results.push(move(sub));
+        }
+    });
+    journal = &submissions;
+
+    // Compressed papers are kept in memory up to paper_cache_mb
+    PaperCache::setCapacity(size_t(ServerConfig::paperCacheMb) << 20);
+
+    // Grading, report building and file I/O run on a bounded worker pool
+    WorkerPool workers("worker", ServerConfig::workerThreads, ServerConfig::workerQueueCapacity,
+                       WorkerPool::parsePolicy(ServerConfig::overloadPolicy));
+
+    // Password hashing (scrypt) has a pool of its own, sized for its memory cost
+    WorkerPool hashers("hasher", ServerConfig::hashThreads, ServerConfig::hashQueueCapacity,
+                       WorkerPool::parsePolicy(ServerConfig::hashOverloadPolicy));
+    hashPool = &hashers;
+
+    // Serve every client from a single epoll event loop; each connection is a
+    // Session state machine instead of a thread blocked in recv()
+    Reactor reactor(server_socket, workers);
+
+    // Worker pool and journal counters are exported with the request metrics
+    Metrics::addCollector([&workers, &hashers](ostream& out) {
+        WorkerPool* pools[] = {&workers, &hashers};
+        out << "# TYPE exam_worker_queue_depth gauge\n";
+        for (WorkerPool* pool : pools)
+            out << "exam_worker_queue_depth{pool=\"" << pool->getName() << "\"} " << pool->stats().queued << "\n";
+        out << "# TYPE exam_worker_active gauge\n";
+        for (WorkerPool* pool : pools)
+            out << "exam_worker_active{pool=\"" << pool->getName() << "\"} " << pool->stats().active << "\n";
+        out << "# TYPE exam_worker_threads gauge\n";
+        for (WorkerPool* pool : pools)
+            out << "exam_worker_threads{pool=\"" << pool->getName() << "\"} " << pool->stats().threads << "\n";
+        out << "# TYPE exam_worker_tasks_total counter\n";
+        for (WorkerPool* pool : pools) {
+            PoolStats s = pool->stats();
+            out << "exam_worker_tasks_total{pool=\"" << pool->getName() << "\",result=\"completed\"} " << s.completed << "\n";
+            out << "exam_worker_tasks_total{pool=\"" << pool->getName() << "\",result=\"rejected\"} " << s.rejected << "\n";
+        }
+        out << "# HELP exam_queue_wait_seconds Time a task spent queued before a worker picked it up.\n";
+        out << "# TYPE exam_queue_wait_seconds histogram\n";
+        for (WorkerPool* pool : pools)
+            Metrics::writeHistogram(out, "exam_queue_wait_seconds", "pool=\"" + pool->getName() + "\"", pool->waitHistogram());
+    });
+    Metrics::addCollector([&submissions](ostream& out) {
+        JournalStats j = submissions.stats();
+        out << "# TYPE exam_journal_records_total counter\nexam_journal_records_total " << j.records << "\n";
+        out << "# TYPE exam_journal_commits_total counter\nexam_journal_commits_total " << j.commits << "\n";
+        out << "# TYPE exam_journal_failed_total counter\nexam_journal_failed_total " << j.failed << "\n";
+        out << "# TYPE exam_journal_sync_seconds_total counter\nexam_journal_sync_seconds_total " << j.totalSyncUs / 1e6 << "\n";
+        out << "# TYPE exam_journal_queue_depth gauge\nexam_journal_queue_depth " << j.queued << "\n";
+    });
+    Metrics::addCollector([&results](ostream& out) {
+        ResultWriterStats r = results.stats();
+        out << "# TYPE exam_result_writer_queue_depth gauge\nexam_result_writer_queue_depth " << r.queued << "\n";
+        out << "# TYPE exam_result_writer_records_total counter\nexam_result_writer_records_total " << r.written << "\n";
+        out << "# TYPE exam_result_writer_flushes_total counter\nexam_result_writer_flushes_total " << r.flushes << "\n";
+        out << "# HELP exam_result_writer_flush_seconds Time to append one batch to the result files.\n";
+        out << "# TYPE exam_result_writer_flush_seconds histogram\n";
+        Metrics::writeHistogram(out, "exam_result_writer_flush_seconds", "writer=\"results\"", results.flushHistogram());
+    });
+    Metrics::addCollector([](ostream& out) {
+        PaperCacheStats c = PaperCache::stats();
+        out << "# TYPE exam_paper_cache_entries gauge\nexam_paper_cache_entries " << c.entries << "\n";
+        out << "# TYPE exam_paper_cache_bytes gauge\nexam_paper_cache_bytes " << c.bytes << "\n";
+        out << "# TYPE exam_paper_cache_requests_total counter\n";
+        out << "exam_paper_cache_requests_total{result=\"hit\"} " << c.hits << "\n";
+        out << "exam_paper_cache_requests_total{result=\"miss\"} " << c.misses << "\n";
+    });
+    Metrics::startExporter(ServerConfig::metricsPort);
+
+    // Report pool and journal statistics every 10 seconds while there is activity
+    uint64_t lastSubmitted = 0;
+    time_t sealedUntil = 0;
+    reactor.setTick(10000, [&workers, &submissions, &results, &lastSubmitted, &sealedUntil]() {
+        SessionTokens::purgeExpired();
+
+        // Seal the papers of scheduled exams as their pre-distribution window
+        // opens (all open windows on the first tick after a restart), so the
+        // first early downloads do not pay for it. Exams the pool turns away
+        // are sealed on first request instead.
+        time_t now = time(nullptr), horizon = now + ServerConfig::predistributeMinutes * 60;
+        for (const auto& exam : ExamCatalog::snapshot()->startingBetween(max(now, sealedUntil + 1), horizon)) {
+            string examName = exam->name;
+            workers.submit([examName]() { ExamSeal::sealedFrame(examName); }, false);
+        }
+        sealedUntil = horizon;
+
+        PoolStats s = workers.stats();
+        if (s.submitted == lastSubmitted && s.queued == 0 && s.active == 0) return;
+        lastSubmitted = s.submitted;
+
+        JournalStats j = submissions.stats();
+        if (j.commits > 0) {
+            cout << "[~] journal: records=" << j.records << " commits=" << j.commits
+                 << " avg batch=" << fixed << setprecision(1) << double(j.records + j.failed) / j.commits
+                 << " max batch=" << j.maxBatch << " avg sync=" << setprecision(2)
+                 << j.totalSyncUs / 1000.0 / j.commits << "ms failed=" << j.failed << endl;
+        }
+        ResultWriterStats r = results.stats();
+        if (r.flushes > 0) {
+            cout << "[~] results: written=" << r.written << " queued=" << r.queued << " flushes=" << r.flushes
+                 << " max batch=" << r.maxBatch << " p99 flush=" << setprecision(2)
+                 << results.flushHistogram().percentile(0.99) / 1000.0 << "ms" << endl;
+        }
+        double avgWaitMs = s.submitted ? s.totalWaitUs / 1000.0 / max<uint64_t>(1, s.completed + s.active) : 0.0;
+        cout << "[~] workers: queued=" << s.queued << " active=" << s.active << "/" << s.threads
+             << " done=" << s.completed << " rejected=" << s.rejected
+             << " avg wait=" << fixed << setprecision(2) << avgWaitMs << "ms"
+             << " max wait=" << s.maxWaitUs / 1000.0 << "ms" << endl;
+    });
+
+    reactor.run();
 }
 
-void Server::analyzeExam(const string& examName, int sock, bool isStudent) {
-    // Construct the path to the exam analysis results file based on examName
-    string filePath = "../data/results/exam_" + examName + "_analysis.txt";
-    // Open the analysis file for reading
-    ifstream file(filePath);
+void Server::analyzeExam(const string& examName, Session& session, bool isStudent) {
+    // Aggregates are updated as each submission commits, so the report below
+    // costs O(questions) however many students took the exam
+    shared_ptr<const ExamImage> image = ExamImage::get(examName);
+    ExamTotals totals{};
+    if (image) totals = ExamStats::forExam(examName, image->questionCount())->totals();
 
-    // Check if file was successfully opened
-    if (!file.is_open()) {
-        cerr << "Failed to open analysis file.\n";
+    // Check if any student has attempted the exam
+    if (totals.students == 0) {
+        cerr << "No analysis data for " << examName << ".\n";
         // Prepare messages to send to client socket indicating no analysis done
         string ms1 = "Analysis of this exam has not been done yet.";
         string ms2 = "The possible cause may be that no student has attempted this exam.";
-        send(sock, ms1.c_str(), ms1.size(), 0);
-        sleep(1);
-        send(sock, ms2.c_str(), ms2.size(), 0);
+        session.reply(ms1);
+        session.reply(ms2);
         // Exit function early as no data to analyze
         return;
     }
 
-    // Read the first line which contains correct answers for each question
-    string line;
-    getline(file, line);
-    vector<string> correctAnswers;
-    stringstream ss(line);
-    char ans;
-    // Extract each answer character and store as string in correctAnswers vector
-    while (ss >> ans) {
-        correctAnswers.push_back(string(1, ans));
-    }
-
     // Store the total number of questions in the exam
-    int numQuestions = correctAnswers.size();
-
-    // Vector to hold student data: studentID and their answers with time spent per question
-    vector<pair<string, vector<pair<string, int>>>> studentDataVector;
-
-    // Read the rest of the file line by line containing each student's responses
-    while (getline(file, line)) {
-        if (line.empty()) continue; // Skip empty lines
-        stringstream ls(line);
-        string studentID;
-        // Read student ID from the line
-        ls >> studentID;
-
-        vector<pair<string, int>> answers; // Vector to store answers and time for each question
-        for (int i = 0; i < numQuestions; ++i) {
-            string answer;
-            int time;
-            // Extract the answer and time spent from the line
-            ls >> answer >> time;
-            // Replace "-" with "NA" to indicate not attempted
-            if (answer == "-") {
-                answers.push_back({"NA", time});
-            } else {
-                answers.push_back({answer, time});
-            }
-        }
-        // Store student ID and their answers in the main vector
-        studentDataVector.push_back({studentID, answers});
-    }
-
-    // Close the file after reading all data
-    file.close();
+    int numQuestions = totals.questions.size();
     // Total number of students who attempted the exam
-    int totalStudents = studentDataVector.size();
-
-    // Initialize vectors to store metrics for each question
-    vector<int> questionAttempts(numQuestions, 0);      // Number of attempts per question
-    vector<int> questionCorrects(numQuestions, 0);      // Number of correct answers per question
-    vector<int> questionSkipped(numQuestions, 0);       // Number of skips per question
-    vector<double> questionTotalTime(numQuestions, 0.0);// Total time spent per question
-    vector<int> studentScores;                           // Score per student
-    vector<double> studentTimes;                         // Total time per student
-    // Count of options selected per question (A, B, C, D, NA)
-    vector<vector<int>> optionCount(numQuestions, vector<int>(5, 0));
-
-    // Iterate over each student's data to compute scores and statistics
-    for (const auto& [studentID, answers] : studentDataVector) {
-        int score = 0;            // Initialize student's score
-        double totalTime = 0.0;   // Initialize total time spent by student
-
-        // Iterate over each question for the current student
-        for (int i = 0; i < numQuestions; ++i) {
-            string ans = answers[i].first;      // Student's answer
-            int timeSpent = answers[i].second;  // Time spent on question
-            totalTime += timeSpent;              // Accumulate total time
-
-            // Check if question was skipped (marked as "NA")
-            if (ans == "NA") {
-                questionSkipped[i]++;            // Increment skipped count for question
-                optionCount[i][4]++;             // Increment NA option count
-            } else {
-                int idx = ans[0] - 'A';          // Convert answer character to index (0-based)
-                optionCount[i][idx]++;           // Increment count of selected option
-                questionAttempts[i]++;            // Increment attempt count for question
-                // Check correctness and update score and correct count
-                if (ans == correctAnswers[i]) {
-                    score += 4;                   // Add 4 points for correct answer
-                    questionCorrects[i]++;        // Increment correct count for question
-                } else {
-                    score -= 1;                   // Subtract 1 point for wrong answer
-                }
-            }
-            // Accumulate total time for the question (all students)
-            questionTotalTime[i] += timeSpent;
-        }
-
-        // Save computed score and total time for the current student
-        studentScores.push_back(score);
-        studentTimes.push_back(totalTime);
-    }
+    int totalStudents = totals.students;
 
     // Prepare a stringstream to build the report output
     stringstream report;
 
     // Calculate average score and average time spent across all students
-    double avgScore = accumulate(studentScores.begin(), studentScores.end(), 0.0) / totalStudents;
-    double avgTime = accumulate(studentTimes.begin(), studentTimes.end(), 0.0) / totalStudents;
-
-    // Create a copy of scores and sort to compute median
-    vector<int> sortedScores = studentScores;
-    sort(sortedScores.begin(), sortedScores.end());
-    // Calculate median score (handle even/odd number of students)
-    double medianScore = (totalStudents % 2 == 0)
-        ? (sortedScores[totalStudents / 2 - 1] + sortedScores[totalStudents / 2]) / 2.0
-        : sortedScores[totalStudents / 2];
+    double avgScore = double(totals.scoreSum) / totalStudents;
+    double avgTime = double(totals.timeSum) / totalStudents;
+    // Median score comes from the score histogram
+    double medianScore = totals.medianScore();
 
     // Write overall exam metrics header and summary
     report << "\n-------------------------------Overall Exam Metrics--------------------------------\n";
@@ -207,14 +296,15 @@ void Server::analyzeExam(const string& examName, int sock, bool isStudent) {
 
     // Loop through each question and write detailed stats
     for (int i = 0; i < numQuestions; ++i) {
-        int attempted = questionAttempts[i];              // Number attempted
-        int correct = questionCorrects[i];                // Number correct
-        int skipped = questionSkipped[i];                 // Number skipped
+        const QuestionCounters& q = totals.questions[i];
+        int attempted = q.attempted;                      // Number attempted
+        int correct = q.correct;                          // Number correct
+        int skipped = q.skipped;                          // Number skipped
         int wrong = attempted - correct;                   // Number wrong
 
         // Calculate percentage correct and average time per question
-        double percentCorrect = (totalStudents > 0) ? (100.0 * correct / totalStudents) : 0.0;
-        double avgQTime = (totalStudents > 0) ? (questionTotalTime[i] / totalStudents) : 0.0;
+        double percentCorrect = 100.0 * correct / totalStudents;
+        double avgQTime = double(q.totalTime) / totalStudents;
 
         // Determine difficulty label based on percentage correct
         string difficulty;
@@ -244,7 +334,7 @@ void Server::analyzeExam(const string& examName, int sock, bool isStudent) {
     for (int i = 0; i < numQuestions; ++i) {
         report << "|   Q" << setw(2) << (i + 1) << "    |";
         for (int j = 0; j < 5; ++j) {
-            report << " " << setw(3) << optionCount[i][j] << " |";
+            report << " " << setw(3) << totals.questions[i].options[j] << " |";
         }
         report << "\n";
         report << "------------------------------------------\n";
@@ -252,307 +342,251 @@ void Server::analyzeExam(const string& examName, int sock, bool isStudent) {
     report << "\n";
 
     // Send the accumulated report string to the client socket
-    send(sock, report.str().c_str(), report.str().size(), 0);
+    session.reply(report.str());
     // Clear the stringstream buffer after sending
     report.str("");
     report.clear();
 
-    // Define a struct to hold ranking data for students
-    struct StudentRankData {
-        string id;         
-        int score;        
-        double time;       
-        int attempted;     
-        int wrong;         
-        int originalIndex;
-    };
-
-    // Vector to hold all students' rank data for leaderboard
-    vector<StudentRankData> leaderboard;
-    for (int i = 0; i < studentDataVector.size(); ++i) {
-        const auto& [id, responses] = studentDataVector[i];
-        int score = studentScores[i];
-        double totalTime = studentTimes[i];
-
-        int attempted = 0, wrong = 0;
-        // Count attempted and wrong answers for the student
-        for (int j = 0; j < responses.size(); ++j) {
-            string ans = responses[j].first;
-            if (ans != "NA") {
-                attempted++;
-                if (ans != correctAnswers[j]) wrong++;
-            }
+    // Students see where they stand and the top of the board; instructors get
+    // every row so they can open any attempt
+    shared_ptr<Leaderboard> board = Leaderboard::forExam(examName);
+    vector<Standing> rows = isStudent ? board->top(ServerConfig::leaderboardTop)
+                                      : board->page(0, board->size());
+
+    if (isStudent) {
+        size_t rank = board->rankOf(session.username);
+        if (rank > 0) {
+            report << "Your Rank: " << rank << " / " << board->size()
+                   << "  (percentile " << fixed << setprecision(1) << board->percentileOf(session.username) << ")\n\n";
         }
-
-        // Add student's ranking data to leaderboard vector
-        leaderboard.push_back({id, score, totalTime, attempted, wrong, i});
     }
 
-    // Sort leaderboard by score descending, and if tie, by time ascending
-    sort(leaderboard.begin(), leaderboard.end(), [](const StudentRankData& a, const StudentRankData& b) {
-        if (a.score != b.score) return a.score > b.score;
-        return a.time < b.time;
-    });
-
     // Write leaderboard header and column titles
     report << "----------------------------------Leaderboard------------------------------------------\n\n";
     report << "|Sr No.| Student ID | Total Marks | Rank |  % Marks  | Avg Time/Q | Attempted | Wrong |\n";
     report << "---------------------------------------------------------------------------------------\n";
 
-    int rank = 1, srno = 1;
-    int totalMarks = correctAnswers.size() * 4;
+    int totalMarks = numQuestions * 4;
 
-    // Iterate over each student in leaderboard and write their ranking info
-    for (const auto& s : leaderboard) {
-        double percentMarks = (100.0 * s.score) / totalMarks;
-        double avgTimePerQ = s.time / correctAnswers.size();
+    // Write one row per ranked attempt
+    for (const Standing& row : rows) {
+        const Submission& s = *row.submission;
+        int score = s.totalMarks();
+        double percentMarks = (100.0 * score) / totalMarks;
+        double avgTimePerQ = double(s.totalTime()) / numQuestions;
 
-        report << "| " << setw(5) << left << srno++ << "|";
-        report << setw(11) << left << s.id << " | ";
-        report << setw(6) << right << s.score << " / " << totalMarks << " | ";
-        report << setw(4) << right << rank++ << " | ";
+        report << "| " << setw(5) << left << row.rank << "|";
+        report << setw(11) << left << s.studentId << " | ";
+        report << setw(6) << right << score << " / " << totalMarks << " | ";
+        report << setw(4) << right << row.rank << " | ";
         report << setw(8) << fixed << setprecision(1) << percentMarks << "% | ";
         report << setw(8) << fixed << setprecision(1) << avgTimePerQ << " s | ";
-        report << setw(9) << right << s.attempted << " | ";
-        report << setw(5) << right << s.wrong << " |\n";
+        report << setw(9) << right << s.attempted() << " | ";
+        report << setw(5) << right << s.wrong() << " |\n";
         report << "---------------------------------------------------------------------------------------\n";
     }
 
     report << "\n";
-    sleep(1); // Pause for 1 second before sending leaderboard
-    // Send leaderboard report to client socket
-    send(sock, report.str().c_str(), report.str().size(), 0);
+    // The leaderboard goes out as its own frame
+    session.reply(report.str());
 
     // If this is a student client, return after sending report
     if(isStudent) return;
 
-    // Server-side loop to allow querying individual student's attempt details
-    while (true) {
-        char buffer[10];
-        // Receive input option from client (index to view student details)
-        int recvBytes = recv(sock, buffer, sizeof(buffer), 0);
-        if (recvBytes <= 0) return; // If connection closed or error, exit
-
-        // Convert received buffer to integer option
-        int opt = atoi(buffer);
-        // Validate option; if invalid or out of range, exit loop
-        if (opt == 0 || opt < 1 || opt > leaderboard.size()) return;
-
-        // Retrieve the selected student's data from leaderboard
-        const auto& selectedStudent = leaderboard[opt - 1];
-        int idxInVector = selectedStudent.originalIndex;
-        const auto& selectedResponses = studentDataVector[idxInVector].second;
-
-        // Prepare output stream to build detailed attempt report
-        ostringstream out;
-        int totalQuestions = correctAnswers.size();
-        int score = 0, attempted = 0, wrong = 0, totalTime = 0;
-
-        // Write header for selected student's attempt details
-        out << "\n========== Attempt Details for Student ID: " << selectedStudent.id << " ==========\n\n";
-        out << "Qno. |     Status     | Marks | Selected | Correct | Time\n";
-        out << "--------------------------------------------------------\n";
-
-        // Loop through each question for detailed status and marks
-        for (int i = 0; i < totalQuestions; ++i) {
-            string selected = selectedResponses[i].first;   // Student's selected answer
-            int timeSpent = selectedResponses[i].second;    // Time spent on question
-
-            string status = "not attempted";
-            string mark = "0";
-
-            // Determine status and marks based on student's answer correctness
-            if (selected != "NA") {
-                attempted++;
-                if (selected == correctAnswers[i]) {
-                    status = "correct";
-                    mark = "+4";
-                    score += 4;
-                } else {
-                    status = "wrong";
-                    mark = "-1";
-                    score -= 1;
-                    wrong++;
-                }
-            }
-
-            totalTime += timeSpent;
-
-            // Format and write the details for each question
-            out << setw(4) << right << i + 1 << " | ";
-            out << setw(14) << left << status << " | ";
-            out << setw(5) << right << mark << " | ";
-            out << setw(8) << left << (selected == "NA" ? "-" : selected) << " | ";
-            out << setw(7) << left << correctAnswers[i] << " | ";
-            out << timeSpent << "s\n";
-        }
-        out << "----------------------------------------------------------\n";
-        // Write summary of student's overall performance
-        out << "\nTotal Marks Obtained   : " << score << " / " << totalMarks << "\n";
-        out << "Total Questions        : " << totalQuestions << "\n";
-        out << "Attempted Questions    : " << attempted << "\n";
-        out << "Wrong Answers          : " << wrong << "\n";
-        out << "Total Time Spent       : " << totalTime << "s\n";
-        out << "----------------------------------------------------------\n";
-
-        // Combine detailed attempt report with the main leaderboard report
-        string res = out.str() + report.str();
-        // Send the combined report to the client
-        send(sock, res.c_str(), res.size(), 0);
-    }
+    // Remember which attempt each Sr No. refers to; later submissions may shift ranks
+    AnalysisView& view = session.analysis;
+    view.examName = examName;
+    view.order.clear();
+    for (const Standing& row : rows) view.order.push_back(row.lsn);
+    view.leaderboardReport = report.str();
+    session.state = SessionState::INSTRUCTOR_ANALYSIS_DETAIL;
 }
 
-void Server::receiveStudentAnswers(int sock, const string& examName) {
-    char buffer[256] = {0};
-
-    // Receive raw answer data from the client
-    int bytesReceived = recv(sock, buffer, sizeof(buffer), 0);
-    if (bytesReceived <= 0) {
-        cerr << "Error: Failed to receive answers from client.\n";
+void Server::handleAnalysisDetail(Session& session, const string& request) {
+    const AnalysisView& view = session.analysis;
+
+    // Convert received buffer to integer option
+    int opt = atoi(request.c_str());
+    // Validate option; if invalid or out of range, go back to the menu
+    Standing selected;
+    if (opt < 1 || opt > (int)view.order.size() ||
+        !Leaderboard::forExam(view.examName)->attempt(view.order[opt - 1], selected)) {
+        session.analysis = AnalysisView();
+        session.state = SessionState::INSTRUCTOR_MENU;
         return;
     }
 
-    // Send acknowledgment to client
-    char ack = 'y';
-    send(sock, &ack, 1, 0);
+    // The selected student's graded answer sheet
+    const Submission& sheet = *selected.submission;
+
+    // Prepare output stream to build detailed attempt report
+    ostringstream out;
+    int totalQuestions = sheet.answers.size();
+    int totalMarks = totalQuestions * 4;
+    int score = 0, attempted = 0, wrong = 0, totalTime = 0;
+
+    // Write header for selected student's attempt details
+    out << "\n========== Attempt Details for Student ID: " << sheet.studentId << " ==========\n\n";
+    out << "Qno. |     Status     | Marks | Selected | Correct | Time\n";
+    out << "--------------------------------------------------------\n";
+
+    // Loop through each question for detailed status and marks
+    for (int i = 0; i < totalQuestions; ++i) {
+        bool skipped = sheet.answers[i] == -1;
+        string answer = skipped ? "-" : string(1, 'A' + sheet.answers[i]);   // Student's selected answer
+        string correct(1, 'A' + sheet.correct[i]);
+        int timeSpent = sheet.times[i];                                       // Time spent on question
+
+        string status = "not attempted";
+        string mark = "0";
+
+        // Determine status and marks based on student's answer correctness
+        if (!skipped) {
+            attempted++;
+            if (sheet.answers[i] == sheet.correct[i]) {
+                status = "correct";
+                mark = "+4";
+                score += 4;
+            } else {
+                status = "wrong";
+                mark = "-1";
+                score -= 1;
+                wrong++;
+            }
+        }
 
-    string data(buffer);
+        totalTime += timeSpent;
 
-    // Verify the received data starts with "ANSWERS"
-    if (data.substr(0, 7) != "ANSWERS") {
+        // Format and write the details for each question
+        out << setw(4) << right << i + 1 << " | ";
+        out << setw(14) << left << status << " | ";
+        out << setw(5) << right << mark << " | ";
+        out << setw(8) << left << answer << " | ";
+        out << setw(7) << left << correct << " | ";
+        out << timeSpent << "s\n";
+    }
+    out << "----------------------------------------------------------\n";
+    // Write summary of student's overall performance
+    out << "\nTotal Marks Obtained   : " << score << " / " << totalMarks << "\n";
+    out << "Total Questions        : " << totalQuestions << "\n";
+    out << "Attempted Questions    : " << attempted << "\n";
+    out << "Wrong Answers          : " << wrong << "\n";
+    out << "Total Time Spent       : " << totalTime << "s\n";
+    out << "----------------------------------------------------------\n";
+
+    // Combine detailed attempt report with the main leaderboard report
+    string res = out.str() + view.leaderboardReport;
+    // Send the combined report to the client
+    session.reply(res);
+}
+
+bool Server::gradeAnswerSheet(const string& studentId, const string& examName, const string& data,
+                              Submission& submission, string& error, const AnswerDraft* draft) {
+    // Binary sheets and final changes (AnswerSheet); text sheets start with "ANSWERS"
+    bool binary = AnswerSheet::isBinary(data), changes = AnswerSheet::isChanges(data);
+    if (!binary && !changes && data.compare(0, 7, "ANSWERS") != 0) {
         cerr << "Invalid data received format.\n";
-        return;
+        error = "Error: Invalid answer sheet format";
+        return false;
     }
 
-    // Get student ID associated with this socket
-    string studentId = socketToUsername[sock];
-
-    // Load correct answers from the answer key file
-    string answerFile = "../data/exams/answers_" + examName + ".txt";
-    vector<int> correctAnswers;
-    ifstream answerIn(answerFile);
-    string line;
-    while (getline(answerIn, line)) {
-        line.erase(remove_if(line.begin(), line.end(), ::isspace), line.end());
-        if (!line.empty()) 
-            correctAnswers.push_back(line[0] - 'A'); // Convert char to index
+    // Correct answers come from the exam's packed answer key
+    shared_ptr<const ExamImage> image = ExamImage::get(examName);
+    if (!image) {
+        cerr << "Exam image for '" << examName << "' not found.\n";
+        error = "Error: Exam not found";
+        return false;
     }
-    answerIn.close();
+    vector<int8_t> correctAnswers = image->answerKey();
 
-    // Prepare to parse submitted answers
-    istringstream dataStream(data.substr(8));  // Skip "ANSWERS "
-    string entry;
+    // Grade into a journal record; marks are derived from answers and key
     int totalQuestions = correctAnswers.size();
-    vector<int> perQuestionMarks(totalQuestions, 0);
-    vector<int> perQuestionTime(totalQuestions, 0);
-    vector<int> perQuestionAnswer(totalQuestions, -1);
-    int totalMarks = 0, totalTimeSpent = 0;
-    int attemptedCount = 0, wrongCount = 0;
+    submission.studentId = studentId;
+    submission.examName = examName;
+    submission.timestamp = getCurrentDateTime();
+    submission.correct = correctAnswers;
+    submission.answers.assign(totalQuestions, -1);
+    submission.times.assign(totalQuestions, 0);
+
+    if (binary) {
+        if (!AnswerSheet::decode(data, image->paperHash(), totalQuestions,
+                                 submission.answers.data(), submission.times.data())) {
+            cerr << "Answer sheet for '" << examName << "' does not match the exam.\n";
+            error = "Error: The answer sheet does not match this exam";
+            return false;
+        }
+        return true;
+    }
 
-    const int positiveMark = 4, negativeMark = -1;
+    // The last changes complete the answers autosaved during the exam
+    if (changes) {
+        if (!draft || draft->answers.size() != (size_t)totalQuestions) {
+            error = "Error: No autosaved answers to complete";
+            return false;
+        }
+        submission.answers = draft->answers;
+        submission.times = draft->seconds;
+        if (!AnswerSheet::applyChanges(data, totalQuestions, submission.answers.data(), submission.times.data())) {
+            error = "Error: Invalid answer sheet format";
+            return false;
+        }
+        return true;
+    }
 
-    // Parse each answer line and compute marks
+    // Sheets saved by older clients: one "question,answer,time" line each
+    istringstream dataStream(data.substr(8));  // Skip "ANSWERS "
+    string entry;
     while (getline(dataStream, entry)) {
         int qIdx, answer, timeSpent;
         char delim;
         istringstream entryStream(entry);
-        entryStream >> qIdx >> delim >> answer >> delim >> timeSpent;
-
-        int marks = 0;
-        if (answer != -1) {
-            attemptedCount++;
-            if (answer == correctAnswers[qIdx]) {
-                marks = positiveMark;
-            } else {
-                marks = negativeMark;
-                wrongCount++;
-            }
-        }
+        if (!(entryStream >> qIdx >> delim >> answer >> delim >> timeSpent)) continue;
+        if (qIdx < 0 || qIdx >= totalQuestions || answer < -1 || answer > 3) continue;
 
-        perQuestionMarks[qIdx] = marks;
-        perQuestionTime[qIdx] = timeSpent;
-        perQuestionAnswer[qIdx] = answer;
-        totalMarks += marks;
-        totalTimeSpent += timeSpent;
+        submission.answers[qIdx] = answer;
+        submission.times[qIdx] = timeSpent > 0 ? timeSpent : 0;
     }
+    return true;
+}
 
-    // Store basic metadata about this attempt
-    string currDateTime = getCurrentDateTime();
-    string perfFile = "../data/results/student_" + studentId + "_attempts.txt";
-    ofstream perfOut(perfFile, ios::app);
-    perfOut << examName << "|";
-    perfOut << currDateTime << "|";
-    perfOut << totalMarks << "|";
-    perfOut << totalQuestions*4 << "|";
-    perfOut << "../data/results/student_" + studentId + "_" + examName + "_performance.txt\n";
-    perfOut.close();
-
-    // Store detailed performance info
-    string scoreFile = "../data/results/student_" + studentId + "_" + examName + "_performance.txt";
-    ofstream scoreOut(scoreFile, ios::app);
-    scoreOut << "START\n";
-    scoreOut << currDateTime << "|";
-    scoreOut << examName + "|";
-    scoreOut << totalMarks << "|" << totalQuestions*4 << "|";
-    scoreOut << totalQuestions << "|" << attemptedCount << "|" << wrongCount << "|";
-    scoreOut << totalTimeSpent << "\nEND\n";
-
-    // Store per-question details
-    for (size_t i = 0; i < perQuestionMarks.size(); ++i) {
-        scoreOut << "Q" << (i + 1) << "|";
-        scoreOut << perQuestionMarks[i] << "|";
-        if (perQuestionAnswer[i] != -1) {
-            scoreOut  << static_cast<char>('A' + perQuestionAnswer[i]) << "|";
-        }
-        else {
-            scoreOut << "NA|";
-        }
-        scoreOut << perQuestionTime[i] << "s\n";
-    }
-    scoreOut.close();
-
-    // Log the attempt in a global attempt file (thread-safe)
-    pthread_mutex_lock(&file_mutex2);
-    string attemptFile = "../data/results/exam_log.txt";
-    ofstream attemptOut(attemptFile, ios::app);
-    attemptOut << studentId << ": " << examName << ": " << getCurrentDateTime() << "\n";
-    attemptOut.close();
-    pthread_mutex_unlock(&file_mutex2);
-
-    // Append to the exam analysis file (or create if not exists)
-    string analysisFile = "../data/results/exam_" + examName + "_analysis.txt";
-    pthread_mutex_lock(&file_mutex3);
-    ifstream infile(analysisFile);
-    bool fileExists = infile.good();
-    infile.close();
-
-    ofstream analysisOut;
-    if (!fileExists) {
-        // Write the answer key on the first line
-        analysisOut.open(analysisFile, ios::out);
-        for (size_t i = 0; i < correctAnswers.size(); ++i) {
-            analysisOut << static_cast<char>('A' + correctAnswers[i]) << " ";
-        }
-        analysisOut << "\n";
-    } else {
-        analysisOut.open(analysisFile, ios::app);
+void Server::receiveStudentAnswers(Session& session, const string& examName, const string& data) {
+    // Get student ID associated with this session
+    string studentId = session.username;
+
+    // A final batch of changes only completes what was autosaved
+    AnswerDraft draft;
+    bool drafted = AnswerSheet::isChanges(data) && SessionTokens::takeAnswers(session.token, examName, draft);
+    if (AnswerSheet::isChanges(data) && !drafted) {
+        // The draft is gone (token expired, server restarted): grading the last
+        // changes alone would blank the rest, so ask for the whole sheet
+        cerr << "[!] No autosaved answers of " << studentId << " for '" << examName << "', full sheet needed" << endl;
+        session.reply(MsgType::ACK, "n");
+        Metrics::observe(Op::SUBMISSION, session.requestStart, false);
+        return;
     }
 
-    // Append the student's answers and time spent
-    analysisOut << studentId;
-    for (size_t i = 0; i < perQuestionAnswer.size(); ++i) {
-        if (perQuestionAnswer[i] == -1) {
-            analysisOut << " - " << perQuestionTime[i];
-            continue;
-        }
-        analysisOut << " " << static_cast<char>('A' + perQuestionAnswer[i]) << " " << perQuestionTime[i];
+    Submission submission;
+    string error;
+    if (!gradeAnswerSheet(studentId, examName, data, submission, error, drafted ? &draft : nullptr)) {
+        session.reply(MsgType::ERROR, error);
+        Metrics::observe(Op::SUBMISSION, session.requestStart, false);
+        return;
     }
-    analysisOut << "\n";
-    analysisOut.close();
-    pthread_mutex_unlock(&file_mutex3);
 
-    // Log completion in server console
-    cout << "[✔] Evaluation complete for " << studentId << " on '" << examName << "'.\n";
+    // Acknowledge only once the submission is durable. The journal batches
+    // concurrent submissions into one write + fdatasync and updates the
+    // leaderboards, totals and attempt index in memory before running this
+    // callback on its committer thread; the result files are written later
+    // by the result writer.
+    Reactor* reactor = session.owner();
+    uint64_t id = session.id;
+    auto start = session.requestStart;
+    journal->append(submission.encode(), [reactor, id, studentId, examName, start](bool committed, uint64_t lsn) {
+        reactor->post(id, [committed](Session& s) { s.reply(MsgType::ACK, committed ? "y" : "n"); });
+        Metrics::observe(Op::SUBMISSION, start, committed);
+        if (committed) cout << "[✔] Evaluation complete for " << studentId << " on '" << examName << "'.\n";
+        else cerr << "Error: Submission of " << studentId << " on '" << examName << "' was not saved.\n";
+    });
 }
 
 string Server::getCurrentDateTime() {
@@ -564,116 +598,133 @@ string Server::getCurrentDateTime() {
     return oss.str();
 }
 
-void Server::handleStudentExamRequest(int sock, ExamManager exam) {
-    char buffer[1024] = {0};
+void Server::handleStudentExamRequest(Session& session, const string& request) {
+    // "<exam number> [codec ...] [if-none-match=<hash>] [have-sealed=<hash>]":
+    // exam as numbered in the catalog, the paper encodings the client can
+    // decode, and the hashes of the plain or sealed copy it has cached
+    shared_ptr<const CatalogSnapshot> catalog = ExamCatalog::snapshot();
+    istringstream iss(request);
+    int examNumber = 0;
+    iss >> examNumber;
+    bool deflate = false, sealed = false;
+    string option, cachedHash, sealedHash;
+    while (iss >> option) {
+        if (option == Compression::DEFLATE) deflate = true;
+        else if (option == "sealed") sealed = true;
+        else if (option.rfind("if-none-match=", 0) == 0) cachedHash = option.substr(14);
+        else if (option.rfind("have-sealed=", 0) == 0) sealedHash = option.substr(12);
+    }
 
-    // Receive the exam number selected by the student
-    int bytesReceived = recv(sock, buffer, sizeof(buffer), 0);
-    if (bytesReceived <= 0) {
-        cerr << "Error: Failed to receive exam selection from client.\n";
+    if (examNumber == 0 || abs(examNumber) > (int)catalog->size()) {  // Invalid selection
+        session.reply(MsgType::ERROR, "Error: Invalid exam selection");
+        session.state = SessionState::STUDENT_MENU;
         return;
     }
 
-    int examNumber = atoi(buffer);
-    if (examNumber == 0) return;  // Invalid selection
-
-    // Check if exam file already exists on the client side
-    bool fileExist = false;
-    if (examNumber < 0) fileExist = true;
-
-    string selectedExamName;
-    istringstream iss(exams[abs(examNumber) - 1]);
-    string line;
+    // The client's copy is current if its hash matches; a negative number is
+    // the older, unconditional "use my local copy"
+    const ExamEntry& selected = catalog->at(abs(examNumber) - 1);
+    bool fileExist = examNumber < 0 || (!cachedHash.empty() && cachedHash == selected.paperHash);
+
+    string selectedExamName = selected.name;
+
+    // Scheduled exams never hand out a readable paper, nor let the exam
+    // begin, before the start, whatever copy the client claims to hold. From
+    // predistribute_minutes ahead, clients that can store it get the sealed
+    // paper; at the start, those holding it only get the key.
+    if (selected.scheduled) {
+        time_t now = time(nullptr);
+        bool sealedCurrent = !sealedHash.empty() && sealedHash == selected.paperHash;
+        if (now < selected.start) {
+            bool early = sealed && !fileExist && now >= selected.start - ServerConfig::predistributeMinutes * 60;
+            shared_ptr<const string> frame;
+            if (early && !sealedCurrent) frame = ExamSeal::sealedFrame(selectedExamName);
+            if (!early || (!frame && !sealedCurrent)) {
+                session.reply(MsgType::ERROR, "Exam '" + selectedExamName + "' starts at " + selected.startTime +
+                                              "; its paper is not available yet.");
+                session.state = SessionState::STUDENT_MENU;
+                return;
+            }
+            if (frame) session.sendShared(frame);
+            else session.reply(MsgType::ACK, "y");
+            session.state = SessionState::STUDENT_EXAM_SEALED;
+            return;
+        }
 
-    // Extract the selected exam's name
-    while (getline(iss, line)) {
-        if (line.find("Exam Name:") != string::npos) {
-            selectedExamName = line.substr(line.find(":") + 2);
-            break;
+        string examKey;
+        if (!fileExist && sealedCurrent && ExamSeal::key(selectedExamName, examKey)) {
+            session.reply(MsgType::PAPER_KEY, examKey);
+            cout << "[+] exam key released for " << selectedExamName << "\n";
+            session.selectedExamName = selectedExamName;
+            session.state = SessionState::STUDENT_EXAM_CONFIRM;
+            return;
         }
     }
 
     // Send the exam questions if not already present on client
     if (!fileExist) {
-        exam.sendExamQuestions(sock, selectedExamName);
+        if (!sendPaper(session, selectedExamName, deflate)) {
+            session.reply(MsgType::ERROR, "Error: Exam not found.\n");
+            session.state = SessionState::STUDENT_MENU;
+            return;
+        }
         cout << "[+] question paper send successfully !\n";
     } else {
+        // Tell the client to go ahead with its local copy
+        session.reply(MsgType::ACK, "y");
         cout << "[+] file already exist on client side !\n";
     }
 
-    memset(buffer, 0, sizeof(buffer));
-
     // Wait for student to confirm whether they want to proceed
-    sleep(2);
-    recv(sock, buffer, sizeof(buffer), 0);
-    string response(buffer);
-
-    if (response == "y" || response == "Y") {
-        string studentId = socketToUsername[sock];
-
-        // Receive exam type: 's' for scheduled, 'p' for practice
-        char typeBuf[32] = {0};
-        recv(sock, typeBuf, sizeof(typeBuf), 0);
-        string examTypeBuffer(typeBuf);
-        string examName = selectedExamName;
-        bool alreadyAttempted = false;
-
-        // For scheduled exams, check if the student has already attempted it
-        if (examTypeBuffer == "s") {
-            string perfFile = "../data/results/student_" + studentId + "_attempts.txt";
-            ifstream infile(perfFile);
-            if (infile.is_open()) {
-                string line;
-                while (getline(infile, line)) {
-                    size_t pos = line.find('|');
-                    if (pos != string::npos) {
-                        string attemptedExam = line.substr(0, pos);
-                        // Trim whitespace
-                        attemptedExam.erase(0, attemptedExam.find_first_not_of(" \t\n\r"));
-                        attemptedExam.erase(attemptedExam.find_last_not_of(" \t\n\r") + 1);
-
-                        if (attemptedExam == examName) {
-                            alreadyAttempted = true;
-                            break;
-                        }
-                    }
-                }
-                infile.close();
-            }
+    session.selectedExamName = selectedExamName;
+    session.state = SessionState::STUDENT_EXAM_CONFIRM;
+}
 
-            // Notify client if already attempted
-            if (alreadyAttempted) {
-                char message = 'y';
-                send(sock, &message, 1, 0);
-                sleep(1);
-                return;
-            } else {
-                char message = 'n';
-                send(sock, &message, 1, 0);
-                sleep(1);
-            }
+/**
+ * Queues the paper of an exam. Clients that accept deflate get the cached
+ * compressed frame; otherwise the PAPER frame pre-encoded in the exam image
+ * goes from the page cache to the socket with sendfile().
+ *
+ * @param session Student session.
+ * @param examName Exam whose paper to send.
+ * @param deflate Whether the client can inflate a PAPER_DEFLATE frame.
+ * @return False if the exam has no image.
+ */
+bool Server::sendPaper(Session& session, const string& examName, bool deflate) {
+    if (deflate) {
+        shared_ptr<const string> frame = PaperCache::deflated(examName);
+        if (frame) {
+            session.sendShared(frame);
+            return true;
         }
+    }
 
-        // Allow some time before receiving answers
-        sleep(3);
+    shared_ptr<const ExamImage> image = ExamImage::get(examName);
+    if (!image) return false;
 
-        // Receive and evaluate student's answers
-        receiveStudentAnswers(sock, examName);
-    }
+    FileSlice slice;
+    slice.owner = image;
+    slice.fd = image->fileDescriptor();
+    slice.offset = image->paperFrameOffset();
+    slice.length = image->paperFrameLength();
+    session.sendFile(slice);
+    return true;
 }
 
-bool Server::handle_authentication(int sock, const string& command, const string& user_type, const string& username, const string& password) {
+bool Server::handle_authentication(Session& session, const string& command, const string& user_type, const string& username, const string& password) {
     // Handle login request
     if (command == "LOGIN") {
-        // Verify user credentials
-        if (AuthManager::authenticate_user(username, password, user_type)) {
-            // Inform client of successful login
-            send(sock, "AUTHENTICATION_SUCCESS", strlen("AUTHENTICATION_SUCCESS"), 0);
+        // Verify user credentials (the user store allows concurrent lookups)
+        bool authenticated = AuthManager::authenticate_user(username, password, user_type);
+        if (authenticated) {
+            // Inform client of successful login, with the token to resume this session
+            session.token = SessionTokens::issue(username, user_type);
+            session.reply("AUTHENTICATION_SUCCESS " + session.token);
             cout << username << " logged in successfully as " << user_type << endl;
             return true;
         } else {
             // Inform client of failed login
-            send(sock, "AUTHENTICATION_FAILED", strlen("AUTHENTICATION_FAILED"), 0);
+            session.reply("AUTHENTICATION_FAILED");
             cerr << "Authentication failed for " << username << endl;
             return false;
         }
@@ -682,14 +733,16 @@ bool Server::handle_authentication(int sock, const string& command, const string
     // Handle user registration request
     else if (command == "REGISTER") {
         // Attempt to register the new user
-        if (AuthManager::register_user(username, password, user_type)) {
-            // Inform client of successful registration
-            send(sock, "REGISTER_SUCCESS", strlen("REGISTER_SUCCESS"), 0);
+        bool registered = AuthManager::register_user(username, password, user_type);
+        if (registered) {
+            // Inform client of successful registration (which also logs in)
+            session.token = SessionTokens::issue(username, user_type);
+            session.reply("REGISTER_SUCCESS " + session.token);
             cout << username << " registered successfully as " << user_type << endl;
             return true;
         } else {
             // Inform client of failed registration
-            send(sock, "REGISTER_FAILED", strlen("REGISTER_FAILED"), 0);
+            session.reply("REGISTER_FAILED");
             cerr << "Registration failed for " << username << endl;
             return false;
         }
@@ -699,534 +752,318 @@ bool Server::handle_authentication(int sock, const string& command, const string
     return false;
 }
 
-void Server::handleViewPerformance(int clientSock, const string& studentId) {
-    // Build the filename storing student's exam attempts
-    string filename = "../data/results/student_" + studentId + "_attempts.txt";
-    ifstream file(filename);
+/**
+ * Puts a reconnecting client back where its session was. A student who was in
+ * an exam gets the paper again, the seconds left and the answers autosaved so
+ * far, and the session waits for the answers; everyone else returns to their
+ * menu.
+ *
+ * @param session Session of the new connection.
+ * @param token Token issued at login.
+ * @param deflate Whether the client accepts a compressed paper.
+ * @return True if the session was resumed.
+ */
+bool Server::handleResume(Session& session, const string& token, bool deflate) {
+    ResumePoint point;
+    if (!SessionTokens::resume(token, point)) {
+        session.reply("RESUME_FAILED");
+        return false;
+    }
+
+    session.username = point.username;
+    session.user_type = point.userType;
+    session.token = token;
+    string resumed = "RESUME_SUCCESS " + point.userType + " " + point.username;
+
+    time_t now = time(nullptr);
+    if (point.userType == "student" && !point.examName.empty() && point.deadline > now &&
+        ExamImage::get(point.examName)) {
+        session.reply(resumed + " " + to_string(point.deadline - now) + " " + point.examName);
+        sendPaper(session, point.examName, deflate);
+
+        // Followed by the answers autosaved before the drop
+        string saved(1, (char)AnswerSheet::CHANGES);
+        if (point.draft.examName == point.examName) {
+            for (size_t q = 0; q < point.draft.answers.size(); ++q)
+                AnswerSheet::addChange(saved, q, point.draft.answers[q], point.draft.seconds[q]);
+        }
+        session.reply(MsgType::ANSWERS_DELTA, saved);
+        session.selectedExamName = point.examName;
+        session.state = SessionState::STUDENT_ANSWERS;
+        cout << point.username << " resumed exam " << point.examName << endl;
+        return true;
+    }
+
+    // The exam (if any) is over; continue from the menu
+    SessionTokens::setExam(token, "", 0);
+    session.reply(resumed);
+    session.state = point.userType == "student" ? SessionState::STUDENT_PENDING_SHEET : SessionState::INSTRUCTOR_MENU;
+    cout << point.username << " resumed session as " << point.userType << endl;
+    return true;
+}
 
-    if (!file.is_open()) {
-        string err = "[!] No exam data found for student.";
-        send(clientSock, err.c_str(), err.size() + 1, 0);
+void Server::handleViewPerformance(Session& session) {
+    // The attempt index answers from memory; the result files are not read
+    session.attempts = AttemptIndex::forStudent(session.username);
+    if (session.attempts.empty()) {
+        session.reply("[!] No exam data found for student.");
         return;
     }
 
-    // Map exam name to vector of attempts (timestamp, marks, performance file path)
-    map<string, vector<tuple<string, string, string>>> examMap;
-    string line;
-
-    // Parse each line in attempts file to fill examMap
-    while (getline(file, line)) {
-        stringstream ss(line);
-        string examName, timestamp, marksObtained, totalMarks, perfPath;
-        getline(ss, examName, '|');
-        getline(ss, timestamp, '|');
-        getline(ss, marksObtained, '|');
-        getline(ss, totalMarks, '|');
-        getline(ss, perfPath);
-
-        // Store all data except performance path separately; keep perfPath in the third tuple element after a '|'
-        examMap[examName].emplace_back(timestamp, marksObtained, totalMarks + "|" + perfPath);
+    sendDashboard(session);
+}
+
+void Server::sendDashboard(Session& session) {
+    // Build dashboard with list of attempted exams and number of attempts
+    string dashboard = "\n========== Attempted Exams ==========\n\n";
+    vector<string>& examNames = session.attemptedExams;
+    examNames.clear();
+    int index = 1;
+    for (auto& pair : session.attempts) {
+        dashboard += "[" + to_string(index++) + "] " + pair.first + " (" + to_string(pair.second.size()) + " attempts)\n";
+        examNames.push_back(pair.first);
     }
-    file.close();
-
-    while (true) {
-        // Build dashboard with list of attempted exams and number of attempts
-        string dashboard = "\n========== Attempted Exams ==========\n\n";
-        vector<string> examNames;
-        int index = 1;
-        for (auto& pair : examMap) {
-            dashboard += "[" + to_string(index++) + "] " + pair.first + " (" + to_string(pair.second.size()) + " attempts)\n";
-            examNames.push_back(pair.first);
-        }
-        dashboard += "\n[0] Back to Main Menu\n--------------------------------------\n";
-        dashboard += "select from above: ";
+    dashboard += "\n[0] Back to Main Menu\n--------------------------------------\n";
+    dashboard += "select from above: ";
 
-        send(clientSock, dashboard.c_str(), dashboard.size() + 1, 0);
+    session.reply(dashboard);
+    session.state = SessionState::DASHBOARD_EXAM;
+}
 
-        // Receive exam selection from client
-        char examChoiceBuf[10] = {0};
-        int bytesReceived = recv(clientSock, examChoiceBuf, sizeof(examChoiceBuf), 0);
-        if (bytesReceived <= 0) {
-            cerr << "Error: Failed to receive exam selection from client.\n";
-            return;
-        }
-        int examChoice = atoi(examChoiceBuf);
-        if (examChoice == 0) break;
-        if (examChoice < 1 || examChoice > examNames.size()){
-            string mesg = "[!] Invalid option! please select a valid exam.";
-            send(clientSock, mesg.c_str(), mesg.size(), 0);
-            usleep(1200000);
-            continue;
-        }
+void Server::handleDashboardExam(Session& session, const string& request) {
+    // Exam selection from client
+    int examChoice = atoi(request.c_str());
+    if (examChoice == 0) {
+        session.state = SessionState::STUDENT_MENU;
+        return;
+    }
+    if (examChoice < 1 || examChoice > session.attemptedExams.size()){
+        string mesg = "[!] Invalid option! please select a valid exam.";
+        session.reply(mesg);
+        sendDashboard(session);
+        return;
+    }
+
+    string selectedExam = session.attemptedExams[examChoice - 1];
+    auto& attempts = session.attempts[selectedExam];
+    session.dashboardExam = selectedExam;
 
-        string selectedExam = examNames[examChoice - 1];
-        auto& attempts = examMap[selectedExam];
+    // Build list of attempts for selected exam
+    string attemptList = "\n=============="+selectedExam+" attempts==============\n\n";
+    for (int i = 0; i < attempts.size(); ++i) {
+        attemptList += "[" + to_string(i + 1) + "] Attempt on: " + attempts[i].timestamp +
+                        " Marks Obtained: " + to_string(attempts[i].marks) + " / " +
+                        to_string(attempts[i].totalMarks) + "\n";
+    }
+    attemptList += "\n[0] Back to Exam List\n";
+    attemptList += "--------------------------------------------------------\n";
+    attemptList += "Select an attempt to view details: ";
+
+    session.reply(attemptList);
+    session.state = SessionState::DASHBOARD_ATTEMPT;
+}
 
-        // Build list of attempts for selected exam
-        string attemptList = "\n=============="+selectedExam+" attempts==============\n\n";
-        for (int i = 0; i < attempts.size(); ++i) {
-            string timestamp = get<0>(attempts[i]);
-            string marksObtained = get<1>(attempts[i]);
-            string totalMarks = get<2>(attempts[i]).substr(0, get<2>(attempts[i]).find('|'));
+void Server::handleDashboardAttempt(Session& session, const string& request) {
+    auto& attempts = session.attempts[session.dashboardExam];
 
-            attemptList += "[" + to_string(i + 1) + "] Attempt on: " + timestamp +
-                            " Marks Obtained: " + marksObtained + " / " + totalMarks + "\n";
+    // Attempt selection from client
+    int attemptChoice = atoi(request.c_str());
+    if (attemptChoice == 0) {
+        sendDashboard(session);
+        return;
+    }
+    if (attemptChoice < 1 || attemptChoice > attempts.size()){
+        string mesg = "[!] Invalid option! please select a valid attempt.";
+        session.reply(mesg);
+        sendDashboard(session);
+        return;
+    } 
+
+    // The attempt ID leads straight to the graded record in the exam's leaderboard
+    const string& examName = session.dashboardExam;
+    Standing standing;
+    if (!Leaderboard::forExam(examName)->attempt(attempts[attemptChoice - 1].lsn, standing)) {
+        string error = "Error: Attempt not found.\n";
+        error += "--------------------------------------------------------\n";
+        error += "select from above: ";
+        session.reply(error);
+        sendDashboard(session);
+        return;
+    }
+    const Submission& sub = *standing.submission;
+
+    // Check if exam is ongoing (for scheduled exams) and block viewing if so
+    shared_ptr<const ExamEntry> exam = ExamCatalog::find(examName);
+    if (exam && exam->scheduled) {
+        if (exam->start == 0) {
+            std::cerr << "Parse failed\n";
+        } else if (time(nullptr) < exam->start + exam->duration * 60) {
+            string msg = "Exam is still going on.";
+            session.reply(msg);
+            session.state = SessionState::STUDENT_MENU;
+            return;
         }
-        attemptList += "\n[0] Back to Exam List\n";
-        attemptList += "--------------------------------------------------------\n";
-        attemptList += "Select an attempt to view details: ";
-
-        send(clientSock, attemptList.c_str(), attemptList.size() + 1, 0);
-        
-        // Receive attempt selection
-        char attemptChoiceBuf[10] = {0};
-        recv(clientSock, attemptChoiceBuf, sizeof(attemptChoiceBuf), 0);
-        int attemptChoice = atoi(attemptChoiceBuf);
-
-        if (attemptChoice == 0) continue;
-        if (attemptChoice < 1 || attemptChoice > attempts.size()){
-            string mesg = "[!] Invalid option! please select a valid attempt.";
-            send(clientSock, mesg.c_str(), mesg.size(), 0);
-            usleep(1200000);
-            continue;
-        } 
-
-        string selectedTimestamp = get<0>(attempts[attemptChoice - 1]);
-        string perfFilePath = get<2>(attempts[attemptChoice - 1]);
-        perfFilePath = perfFilePath.substr(perfFilePath.find('|') + 1);
-
-        ifstream perfFile(perfFilePath);
-        if (!perfFile.is_open()) {
-            string error = "Error: Performance file not found.\n";
-            attemptList += "\n[0] Back to Exam List\n";
-            error += "--------------------------------------------------------\n";
-            error += "select from above: ";
-            send(clientSock, error.c_str(), error.size() + 1, 0);
-            continue;
+    }
+
+    int totalQuestions = sub.answers.size();
+    string formatted = "\n========== Attempt Details ==========\n\n";
+    formatted += "Exam: " + examName + "\n";
+    formatted += "Attempt Date: " + sub.timestamp + "\n\n";
+    formatted += "Total Marks Obtained   : " + to_string(sub.totalMarks()) + " / " + to_string(totalQuestions * 4) + "\n";
+    formatted += "Total Questions        : " + to_string(totalQuestions) + "\n";
+    formatted += "Attempted Questions    : " + to_string(sub.attempted()) + "\n";
+    formatted += "Wrong Answers          : " + to_string(sub.wrong()) + "\n";
+    formatted += "Total Time Spent       : " + to_string(sub.totalTime()) + "s\n\n";
+
+    // Prepare question-wise summary table, against the key the attempt was graded with
+    formatted += "Qno.  | Status  | Marks | Selected | Correct | Time\n";
+    formatted += "--------------------------------------------------------\n";
+    for (int q = 0; q < totalQuestions; ++q) {
+        string status, markDisplay, selected;
+        int mark = sub.marks(q);
+        string correct(1, 'A' + sub.correct[q]);
+
+        if (sub.answers[q] == -1) {
+            status = "NA";
+            markDisplay = "-";
+            selected = "-";
+        } else {
+            status = (mark < 0) ? "wrong" : "correct";
+            markDisplay = (mark > 0 ? "+" : "") + to_string(mark);
+            selected = string(1, 'A' + sub.answers[q]);
         }
 
-        string formatted, line, examName;
-        // Read performance file to find matching attempt's detailed record
-        while (getline(perfFile, line)) {
-            if (line == "START") {
-                string summaryLine;
-                if (!getline(perfFile, summaryLine)) break;
-
-                stringstream ss(summaryLine);
-                string timestamp, marksObtained, totalMarks, totalQuestions, attempted, wrong, totalTime;
-                getline(ss, timestamp, '|');
-                if (timestamp != selectedTimestamp) {
-                    // Skip to next START if timestamp does not match
-                    while (getline(perfFile, line) && line != "START");
-                    if (line == "START") {
-                        perfFile.seekg(-line.length()-1, ios::cur); 
-                    }
-                    continue;
-                }
-
-                // Parse summary line details
-                getline(ss, examName, '|');
-                getline(ss, marksObtained, '|');
-                getline(ss, totalMarks, '|');
-                getline(ss, totalQuestions, '|');
-                getline(ss, attempted, '|');
-                getline(ss, wrong, '|');
-                getline(ss, totalTime, '|');
-
-                // Check if exam is ongoing (for scheduled exams) and block viewing if so
-                for (const auto& exam : exams) {
-                    istringstream iss(exam);
-                    string exam_name, exam_type, start_time, duration, line;
-                    bool include_exam = false;
-                    while (getline(iss, line)) {
-                        if (line.find("Exam Name:") != string::npos) {
-                            exam_name = line.substr(line.find(":") + 2);
-                            if (exam_name == examName) 
-                                include_exam = true;
-                        }
-                        if (line.find("Duration (minutes):") != string::npos)
-                            duration = line.substr(line.find(":") + 2);
-                        if (line.find("Exam type:") != string::npos) 
-                            exam_type = line.substr(line.find(":") + 2);
-                        if (line.find("Start Time:") != string::npos) 
-                            start_time = line.substr(line.find(":") + 2);
-                    }
-                    if (include_exam) {
-                        if(exam_type == "q") break;
-                        tm tm = {};
-                        istringstream ss(start_time);
-                        int dur = stoi(duration);
-                    
-                        ss >> get_time(&tm, "%Y-%m-%d %H:%M:%S");
-                        if (ss.fail()) {
-                            std::cerr << "Parse failed\n";
-                            break;
-                        }
-                        time_t time_value = std::mktime(&tm);
-                        time_t later = time_value + dur*60;
-                        time_t current_time = std::time(nullptr);
-                        if(current_time < later){
-                            string msg = "Exam is still going on.";
-                            send(clientSock, msg.c_str(), msg.size(), 0);
-                            sleep(1);
-                            return;
-                        }
-                        break;
-                    }
-                }
-                
-                formatted = "\n========== Attempt Details ==========\n\n";
-                formatted += "Exam: " + examName + "\n";
-                formatted += "Attempt Date: " + timestamp + "\n\n";
-                formatted += "Total Marks Obtained   : " + marksObtained + " / " + totalMarks + "\n";
-                formatted += "Total Questions        : " + totalQuestions + "\n";
-                formatted += "Attempted Questions    : " + attempted + "\n";
-                formatted += "Wrong Answers          : " + wrong + "\n";
-                formatted += "Total Time Spent       : " + totalTime + "s\n\n";
-
-                string ansFilePath = "../data/exams/answers_" + examName + ".txt";
-                ifstream ansFile(ansFilePath);
-                vector<string> answers;
-                if (ansFile.is_open()) {
-                    string ansLine;
-                    while (getline(ansFile, ansLine)) {
-                        answers.push_back(ansLine);
-                    }
-                    ansFile.close();
-                }
-
-                // Prepare question-wise summary table
-                formatted += "Qno.  | Status  | Marks | Selected | Correct | Time\n";
-                formatted += "--------------------------------------------------------\n";
-                // Skip lines until the performance answers section
-                while (getline(perfFile, line) && line != "END");
-                int qNum = 1;
-                while (getline(perfFile, line)) {
-                    if (line == "START") break;
-
-                    stringstream qss(line);
-                    string questionStr, markStr, optStr, timeStr;
-                    getline(qss, questionStr, '|');
-                    getline(qss, markStr, '|');
-                    getline(qss, optStr, '|');
-                    getline(qss, timeStr, 's');
-
-                    string status, markDisplay, selected, correct;
-                    int mark = stoi(markStr);
-                    selected = (optStr == "NA") ? "-" : optStr;
-                    correct = (qNum - 1 < answers.size()) ? answers[qNum - 1] : "?";
-
-                    if (optStr == "NA") {
-                        status = "NA";
-                        markDisplay = "-";
-                    } else {
-                        status = (mark == -1) ? "wrong" : "correct";
-                        markDisplay = (mark > 0 ? "+" : "") + markStr;
-                    }
-
-                    stringstream row;
-                    row << setw(5)  << qNum << " | "
-                        << setw(7) << status << " | "
-                        << setw(5)  << markDisplay << " | "
-                        << setw(8)  << selected << " | "
-                        << setw(7)  << correct << " | "
-                        << timeStr << "s\n";
-                    formatted += row.str();
-
-                    qNum++;
-                }
-                formatted += "\n--------------------------------------------------------\n";
-                perfFile.close();
-                send(clientSock, formatted.c_str(), formatted.size() + 1, 0);
-
-                // Send full question paper for this exam
-                string examFilePath = "../data/exams/questions_" + examName + ".txt";
-                ifstream examFile(examFilePath);
-                if (examFile.is_open()) {
-                    formatted = examName +"\n";
-                    string qLine;
-                    int qNum = 1;
-                    while (getline(examFile, qLine)) {
-                        if (qLine.empty()) {
-                            formatted += "\n";
-                            continue;
-                        }
-                        if (qLine[0] == ' ') {
-                            formatted += "Q" + to_string(qNum++) + "." + qLine + "\n";
-                        } else {
-                            formatted += qLine + "\n";
-                        }
-                    }
-                    formatted += "--------------------------END OF QUESTION PAPER------------------------------\n";
-                    examFile.close();
-                }
-                break;
+        stringstream row;
+        row << setw(5)  << q + 1 << " | "
+            << setw(7) << status << " | "
+            << setw(5)  << markDisplay << " | "
+            << setw(8)  << selected << " | "
+            << setw(7)  << correct << " | "
+            << sub.times[q] << "s\n";
+        formatted += row.str();
+    }
+    formatted += "\n--------------------------------------------------------\n";
+    session.reply(formatted);
+
+    // Send full question paper for this exam
+    formatted.clear();
+    shared_ptr<const ExamImage> image = ExamImage::get(examName);
+    if (image) {
+        istringstream examFile{string(image->paper())};
+        formatted = examName +"\n";
+        string qLine;
+        int qNum = 1;
+        while (getline(examFile, qLine)) {
+            if (qLine.empty()) {
+                formatted += "\n";
+                continue;
+            }
+            if (qLine[0] == ' ') {
+                formatted += "Q" + to_string(qNum++) + "." + qLine + "\n";
+            } else {
+                formatted += qLine + "\n";
             }
         }
-        sleep(1);
-        send(clientSock, formatted.c_str(), formatted.size() + 1, 0);
-       
-        char leaderboardbuf[10] = {0};
-        bytesReceived = recv(clientSock, leaderboardbuf, sizeof(leaderboardbuf), 0);
-        if (bytesReceived <= 0) {
-            cerr << "Error: Failed to receive exam selection from client.\n";
-            return;
-        }
-        int leaderboard = atoi(leaderboardbuf);
-        if(leaderboard==0 || leaderboard!=1) continue;
-
-        analyzeExam(selectedExam, clientSock, true);
-        break;
+        formatted += "--------------------------END OF QUESTION PAPER------------------------------\n";
     }
+
+    // Send the question paper as its own frame, right after the details
+    session.reply(formatted);
+
+    // Wait for the leaderboard choice
+    session.state = SessionState::DASHBOARD_LEADERBOARD;
 }
 
-void Server::sendAvailableExams(int sock, const string& username, vector<string>& examNames) {
+void Server::sendAvailableExams(Session& session, const string& username, vector<string>& examNames) {
     string all_exams;
     int qno = 1;
     examNames.clear();
 
-    for (const auto& exam : exams) {
-        istringstream iss(exam);
-        ostringstream filteredExam;
-        string line;
-        string instructor_name;
-        string exam_name, exam_type;
-        bool include_exam = false;
-
-        while (getline(iss, line)) {
-            if (line.find("Instructor:") != string::npos) {
-                instructor_name = line.substr(line.find(":") + 2);
-                if (instructor_name == username) {
-                    include_exam = true;
-                }
-            }
-
-            if (line.find("Exam Name:") != string::npos)
-                exam_name = line.substr(line.find(":") + 2);
-            if (line.find("Exam type:") != string::npos){
-                exam_type = line.substr(line.find(":") + 2);
-                if(exam_type == "g") exam_type = "Exam type: Scheduled Test";
-                else exam_type = "Exam type: Practice Test";
-                filteredExam << exam_type << " | ";
-                continue;
-            }
-            if (line.find("Instructor:") != std::string::npos) continue;
-            filteredExam << line << " | ";
-        }
-        if (include_exam) {
-            examNames.push_back(exam_name);
-            all_exams += to_string(qno++) + ". " + filteredExam.str() + "\n";
-        }
+    // Instructor index of the catalog: only this instructor's exams, in upload order
+    for (const auto& exam : ExamCatalog::snapshot()->byInstructor(username)) {
+        string exam_type = exam->type == "g" ? "Exam type: Scheduled Test" : "Exam type: Practice Test";
+        examNames.push_back(exam->name);
+        all_exams += to_string(qno++) + ". Exam Name: " + exam->name + " | " + exam_type +
+                     " | Start Time: " + exam->startTime + " | Duration (minutes): " + to_string(exam->duration) +
+                     " | Total Questions: " + to_string(exam->totalQuestions) + " | \n";
     }
 
     if (all_exams.empty()) {
         all_exams = "[!] You have not uploaded any exam.";
     }
 
-    all_exams += "\0";
-    send(sock, all_exams.c_str(), all_exams.size(), 0);
+    session.reply(all_exams);
 }
 
-void* Server::handle_client(void* client_socket) {
-    
-    int sock = *(int*)client_socket;
-    char buffer[1024] = {0};
-    string command, user_type, username, password;
-    int attempts=0;
-
-    // --- Authentication loop ---
-    while (true) {
-        memset(buffer, 0, sizeof(buffer));
-        recv(sock, buffer, sizeof(buffer), 0);
-        string request(buffer);
-        if (request == "exit") break;
-    
-        istringstream iss(request);
-        iss >> command >> user_type >> username >> password;
-    
-        // Ensure thread-safe access to shared resources during authentication
-        pthread_mutex_lock(&file_mutex1);
-        bool authenticated = handle_authentication(sock, command, user_type, username, password);
-        if (authenticated) {
-            Server::socketToUsername[sock] = username;
-        }
-        pthread_mutex_unlock(&file_mutex1);
-    
-        if (authenticated) break;
-    }
+bool Server::sendStudentExamList(Session& session) {
+    // Build a formatted list of available exams
+    shared_ptr<const CatalogSnapshot> catalog = ExamCatalog::snapshot();
+    string all_exams;
+    for (size_t i = 0; i < catalog->size(); ++i)
+        all_exams += to_string(i + 1) + ". " + catalog->at(i).listing + "\n";
+
+    // Send available exams to student
+    if (all_exams.empty())
+        all_exams = "No exams available.";
     
+    session.reply(all_exams);
+    // If exams are available, the student picks one next
+    return all_exams != "No exams available.";
+}
+
+void Server::handleUploadExam(Session& session, const string& examData) {
     ExamManager exam_manager;
+    string response = "";
 
-    // === Student-specific logic ===
-    if (user_type == "student") {
-        char mesg[32]={0};
+    // Parse exam details
+    size_t pos1 = examData.find("|");
+    string examName = examData.substr(0, pos1);
 
-        // Receive exam name (if submitting pending answers)
-        int bytes_received = recv(sock, mesg, sizeof(mesg), 0);
-        if (bytes_received <= 0) return nullptr;
+    size_t pos2 = examData.find("|", pos1 + 1);
+    string exam_type = examData.substr(pos1+1, pos2-pos1-1);  
 
-        string examName(mesg);
-        examName.erase(0, examName.find_first_not_of(" \t\n\r")); 
-        examName.erase(examName.find_last_not_of(" \t\n\r") + 1); 
+    size_t pos3 = examData.find("|", pos2 + 1);
+    int examDuration = atoi(examData.substr(pos2 + 1, pos3 - pos2 - 1).c_str());
 
-        if(examName!="n"){
-            receiveStudentAnswers(sock, examName);
-        }
+    size_t pos4 = examData.find("|", pos3 + 1);
+    string examFileName = "../data/exams/" + examData.substr(pos3 + 1, pos4 - pos3 - 1);
 
-        // Main loop for student interaction
-        while (true){
-            memset(buffer, 0, sizeof(buffer));
-            int bytes_received = recv(sock, buffer, sizeof(buffer), 0);
-            if (bytes_received <= 0) break;
-            buffer[bytes_received] = '\0';
-            string request(buffer);
-            
-            if (request == "1") {
-                // Build a formatted list of available exams
-                string all_exams;
-                int qno = 1;
-                for (auto& exam : exams) {
-                    string formattedExam;
-                    istringstream iss(exam);
-                    string line;
-                    
-                    while (getline(iss, line)) 
-                        formattedExam += line + " | ";
-        
-                    if (!formattedExam.empty() && formattedExam.back() == ' ')
-                        formattedExam.pop_back();
-
-                    all_exams += to_string(qno) + ". " + formattedExam + "\n";
-                    qno++;
-                }
-            
-                // Send available exams to student
-                if (all_exams.empty())
-                    all_exams = "No exams available.";
-                
-                send(sock, all_exams.c_str(), all_exams.size(), 0);
-                // If exams are available, handle request
-                if(all_exams!="No exams available.")
-                    handleStudentExamRequest(sock, exam_manager);
-            }
-            
-            else if (request == "2") {
-                handleViewPerformance(sock, username);
-            }
-            else if(request == "3") break;
+    string start_time = "";
+    if(exam_type=="g" || exam_type=="G"){
+        start_time = examData.substr(pos4+1);
+
+        // Validate date format
+        tm tm_input = {};
+        istringstream ss(start_time);
+        ss >> get_time(&tm_input, "%Y-%m-%d %H:%M:%S");
+        if (ss.fail()) {
+            std::cerr << "Invalid format. Please use YYYY-MM-DD HH:MM:SS\n";
+            response = "Invalid format. Please use YYYY-MM-DD HH:MM:SS";
+            session.reply(response);
+            return;
         }
     }
-    // === Instructor-specific logic ===
-    else if (user_type == "instructor") {
-        while (true){
-            memset(buffer, 0, sizeof(buffer));
-            int bytes_received = recv(sock, buffer, sizeof(buffer), 0);
-            buffer[bytes_received] = '\0';
-            string request(buffer);
-            string response = "";
-
-            // === Upload new exam ===
-            if (request == "1") {
-                memset(buffer, 0, sizeof(buffer));
-                recv(sock, buffer, sizeof(buffer), 0);
-                string examData(buffer);
-            
-                // Parse exam details
-                size_t pos1 = examData.find("|");
-                string examName = examData.substr(0, pos1);
-
-                size_t pos2 = examData.find("|", pos1 + 1);
-                string exam_type = examData.substr(pos1+1, pos2-pos1-1);  
-
-                size_t pos3 = examData.find("|", pos2 + 1);
-                int examDuration = atoi(examData.substr(pos2 + 1, pos3 - pos2 - 1).c_str());
-
-                size_t pos4 = examData.find("|", pos3 + 1);
-                string examFileName = "../data/exams/" + examData.substr(pos3 + 1, pos4 - pos3 - 1);
-
-                string start_time = "";
-                if(exam_type=="g" || exam_type=="G"){
-                    start_time = examData.substr(pos4+1);
-
-                    // Validate date format
-                    tm tm_input = {};
-                    istringstream ss(start_time);
-                    ss >> get_time(&tm_input, "%Y-%m-%d %H:%M:%S");
-                    if (ss.fail()) {
-                        std::cerr << "Invalid format. Please use YYYY-MM-DD HH:MM:SS\n";
-                        response = "Invalid format. Please use YYYY-MM-DD HH:MM:SS";
-                        send(sock,response.c_str(),response.size(),0);
-                        continue;
-                    }
-                }
-
-                // Check for existing exam with the same name
-                ifstream file("../data/exams/exam_list.txt");
-                bool found = false;
-                if (file.is_open()) {
-                    string line;
-                    while (getline(file, line)) {
-                        size_t pos = line.find('|');
-                        if (pos != string::npos) {
-                            string name = line.substr(0, pos);
-                            if (name == examName) {
-                                found = true;
-                                break;
-                            }
-                        }
-                    }
-                    file.close();
-                } else {
-                    cerr << "Failed to open exam list file.\n";
-                }
-
-                if (found) {
-                    response = "Exam '" + examName + "' already exists.\n";
-                } else {
-                    // Upload exam or show error
-                    if (exam_manager.parse_exam(exam_type ,examFileName, examName, username, examDuration, start_time)) {
-                        pthread_mutex_lock(&file_mutex1);
-                        exams = exam_manager.load_exam_metadata("../data/exams/exam_list.txt");
-                        pthread_mutex_unlock(&file_mutex1);
-                        response = "Exam successfully uploaded!"; 
-                    } else response = "Error: Invalid exam format!";      
-                }
-                send(sock,response.c_str(),response.size(),0);
-            }
-            // === View exam analysis ===
-            else if (request == "3"){
-                vector<string> examNames;
-                sendAvailableExams(sock, username, examNames);
-                if (examNames.empty()) continue;
-
-                char buffer[10];
-                int len = recv(sock, buffer, sizeof(buffer), 0);
-                if (len <= 0) {
-                    cerr << "Failed to receive selection.\n";
-                    break;
-                }
-            
-                buffer[len] = '\0';
-                int selection = atoi(buffer);
-                            if (selection <= 0 || selection > (int)examNames.size()) {
-                    string err = "[!] Invalid exam selection.";
-                    send(sock, err.c_str(), err.size(), 0);
-                    continue;
-                }
-                string selectedExamName = examNames[selection - 1];
-                analyzeExam(selectedExamName, sock, false);
-            }
-            // === View uploaded exams ===
-            else if (request == "4") {
-                vector<string> all_exams;
-                sendAvailableExams(sock, username, all_exams);
+
+    // Check for existing exam with the same name
+    if (ExamCatalog::find(examName)) {
+        response = "Exam '" + examName + "' already exists.\n";
+    } else {
+        // Upload exam or show error
+        if (exam_manager.parse_exam(exam_type ,examFileName, examName, session.username, examDuration, start_time)) {
+            // Add just this exam to the catalog
+            ExamEntry entry;
+            if (exam_manager.load_exam_entry("../data/exams/metadata_" + examName + ".txt", entry) &&
+                ExamCatalog::insert(entry)) {
+                response = "Exam successfully uploaded!";
+
+                // Compress (and for scheduled exams, seal) the paper now instead of
+                // during the first burst of downloads
+                PaperCache::deflated(examName);
+                if (entry.scheduled) ExamSeal::sealedFrame(examName);
+            } else {
+                response = "Exam '" + examName + "' already exists.\n";
             }
-            else if (response=="5") break;
-        }
+        } else response = "Error: Invalid exam format!";      
     }
-
-    // === Final cleanup ===
-    close(sock);
-    cout << "[-] client[ "<<username<<" ] disconnected!"<<endl;
-    return nullptr;
-}
\ No newline at end of file
+    session.reply(response);
+}
@@ -19,9 +19,13 @@
 #include <unordered_set>
 #include <chrono>
 #include <numeric>
+#include <sys/stat.h>
 
 #include "auth.h"
 #include "exam_manager.h"
+#include "session.h"
+#include "submission.h"
+#include "session_tokens.h"
 
 using namespace std;
 
@@ -29,18 +33,30 @@ class Server {
 public:
     Server(int port);
     void start();
-    static map<int, string> socketToUsername;
     
 private:
+    friend class Session;
+    friend class Bench;
+
     int server_socket;
-    static void receiveStudentAnswers(int sock, const string& examName);
-    static bool handle_authentication(int sock, const string& command, const string& user_type, const string& username, const string& password);    
-    static void* handle_client(void* client_socket);
-    static void handleStudentExamRequest(int sock, ExamManager exam);
+    static WorkerPool* hashPool;        // runs logins and registrations
+    static void receiveStudentAnswers(Session& session, const string& examName, const string& data);
+    static bool gradeAnswerSheet(const string& studentId, const string& examName, const string& data, Submission& submission,
+                                 string& error, const AnswerDraft* draft = nullptr);
+    static bool handle_authentication(Session& session, const string& command, const string& user_type, const string& username, const string& password);    
+    static bool handleResume(Session& session, const string& token, bool deflate);
+    static bool sendStudentExamList(Session& session);
+    static void handleStudentExamRequest(Session& session, const string& request);
+    static bool sendPaper(Session& session, const string& examName, bool deflate);
     static string getCurrentDateTime();
-    static void handleViewPerformance(int sock, const string& username);
-    static void sendAvailableExams(int sock, const string& username, vector<string>& examNames);
-    static void analyzeExam(const string& examName, int sock, bool isStudenet);
+    static void handleViewPerformance(Session& session);
+    static void sendDashboard(Session& session);
+    static void handleDashboardExam(Session& session, const string& request);
+    static void handleDashboardAttempt(Session& session, const string& request);
+    static void sendAvailableExams(Session& session, const string& username, vector<string>& examNames);
+    static void handleUploadExam(Session& session, const string& examData);
+    static void analyzeExam(const string& examName, Session& session, bool isStudenet);
+    static void handleAnalysisDetail(Session& session, const string& request);
 };
 
 #endif
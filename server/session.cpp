@@ -0,0 +1,378 @@
+#include "session.h"
+#include "reactor.h"
+#include "server.h"
+#include "config.h"
+#include "metrics.h"
+#include "session_tokens.h"
+#include "exam_catalog.h"
+#include "compression.h"
+#include "answer_sheet.h"
+
+/**
+ * Creates the state machine for a freshly accepted connection.
+ *
+ * @param id Connection id assigned by the reactor.
+ * @param fd Client socket.
+ * @param reactor Event loop that owns the connection.
+ */
+Session::Session(uint64_t id, int fd, Reactor* reactor)
+    : id(id), fd(fd), state(SessionState::AUTH), busy(false), reactor(reactor),
+      requestState(SessionState::AUTH) {}
+
+/**
+ * Queues a text message for the client.
+ *
+ * @param data Message text.
+ */
+void Session::reply(const string& data) {
+    reply(MsgType::TEXT, data);
+}
+
+/**
+ * Queues one frame for the client. On a worker thread the frame is held until
+ * the job is handed back to the reactor.
+ *
+ * @param type Message type.
+ * @param data Payload.
+ */
+void Session::reply(MsgType type, const string& data) {
+    OutChunk chunk;
+    chunk.data = Protocol::encode(type, data);
+    if (busy) {
+        deferred.push_back(move(chunk));
+        return;
+    }
+    reactor->queue(id, move(chunk));
+}
+
+/**
+ * Queues a pre-encoded frame stored in a file (e.g. an exam paper); it is
+ * written with sendfile() and never copied through user space.
+ *
+ * @param slice File range holding complete frame(s).
+ */
+void Session::sendFile(const FileSlice& slice) {
+    OutChunk chunk;
+    chunk.file = slice;
+    if (busy) {
+        deferred.push_back(move(chunk));
+        return;
+    }
+    reactor->queue(id, move(chunk));
+}
+
+/**
+ * Queues a pre-encoded frame shared with other connections (e.g. a cached
+ * compressed paper) without copying it.
+ *
+ * @param frame Complete encoded frame.
+ */
+void Session::sendShared(shared_ptr<const string> frame) {
+    OutChunk chunk;
+    chunk.shared = move(frame);
+    if (busy) {
+        deferred.push_back(move(chunk));
+        return;
+    }
+    reactor->queue(id, move(chunk));
+}
+
+/**
+ * Ends the session; the reactor closes the socket once output is flushed.
+ */
+void Session::close() {
+    state = SessionState::CLOSED;
+}
+
+/**
+ * Runs a slow handler (disk I/O, grading, report building) on the worker pool.
+ * If the pool is saturated the request is answered according to the overload
+ * policy: "busy" rewinds the state machine and tells the client when to resend
+ * the request, "shed" drops the connection.
+ *
+ * @param job Handler to run against this session.
+ * @param pool Pool to run it on; defaults to the general worker pool.
+ */
+void Session::offload(function<void(Session&)> job, WorkerPool* pool) {
+    if (reactor->submit(id, move(job), pool)) return;
+
+    OverloadPolicy policy = pool ? pool->getPolicy() : WorkerPool::parsePolicy(ServerConfig::overloadPolicy);
+    if (policy == OverloadPolicy::BUSY) {
+        state = requestState;
+        reply(MsgType::BUSY, to_string(ServerConfig::retryAfterMs));
+    } else {
+        cerr << "[!] Worker queue full, dropping client" << endl;
+        close();
+    }
+}
+
+/**
+ * Advances the state machine with one frame received from the client.
+ *
+ * @param frame Decoded request.
+ */
+void Session::onMessage(const Frame& frame) {
+    const string& request = frame.payload;
+
+    if (state == SessionState::CLOSED) return;
+
+    // Autosaved answers arrive in between the exam's other messages and get no reply
+    if (frame.type == MsgType::ANSWERS_DELTA) {
+        if (state == SessionState::STUDENT_ANSWERS) saveAnswers(request);
+        return;
+    }
+
+    requestState = state;
+    requestStart = chrono::steady_clock::now();
+    if (state == SessionState::AUTH) {
+        onAuth(request);
+    } else if (user_type == "student") {
+        onStudentMessage(request);
+    } else {
+        onInstructorMessage(request);
+    }
+}
+
+/**
+ * Moves a student into the running exam and records its deadline against the
+ * session token, so a reconnect can pick the exam up again.
+ */
+void Session::beginExam() {
+    state = SessionState::STUDENT_ANSWERS;
+    shared_ptr<const ExamEntry> exam = ExamCatalog::find(selectedExamName);
+    time_t deadline = time(nullptr) + (exam ? exam->duration * 60 : 0);
+    SessionTokens::setExam(token, selectedExamName, deadline);
+    // A blank draft, so a final submit with nothing autosaved before is complete
+    saveAnswers(string(1, (char)AnswerSheet::CHANGES));
+}
+
+/**
+ * Keeps a batch of answer changes in the exam's draft, which the final submit
+ * (and a resumed session) picks up.
+ *
+ * @param changes Batch encoded with AnswerSheet::addChange.
+ */
+void Session::saveAnswers(const string& changes) {
+    shared_ptr<const ExamImage> image = ExamImage::get(selectedExamName);
+    if (!image || !SessionTokens::saveAnswers(token, selectedExamName, image->questionCount(), changes))
+        cerr << "[!] Dropped autosaved answers of " << username << " for '" << selectedExamName << "'" << endl;
+}
+
+/**
+ * Handles the authentication loop: LOGIN / REGISTER requests and "exit".
+ *
+ * @param request Client request ("<command> <user_type> <username> <password>").
+ */
+void Session::onAuth(const string& request) {
+    if (request == "exit") {
+        close();
+        return;
+    }
+
+    string command, type, name, password;
+    istringstream iss(request);
+    iss >> command >> type >> name >> password;
+
+    // "RESUME <token> [deflate]": a reconnecting client, no password to hash
+    if (command == "RESUME") {
+        bool deflate = name == Compression::DEFLATE;
+        offload([type, deflate](Session& s) {
+            bool ok = Server::handleResume(s, type, deflate);
+            Metrics::observe(Op::RESUME, s.requestStart, ok);
+        });
+        return;
+    }
+
+    // Password hashing is deliberately slow, so it gets its own pool and a
+    // burst of logins cannot starve submissions or downloads of workers
+    offload([command, type, name, password](Session& s) {
+        bool ok = Server::handle_authentication(s, command, type, name, password);
+        Metrics::observe(command == "REGISTER" ? Op::REGISTER : Op::LOGIN, s.requestStart, ok);
+        if (!ok) return;
+
+        s.username = name;
+        s.user_type = type;
+        if (s.user_type == "student") {
+            s.state = SessionState::STUDENT_PENDING_SHEET;
+        } else if (s.user_type == "instructor") {
+            s.state = SessionState::INSTRUCTOR_MENU;
+        } else {
+            s.close();
+        }
+    }, Server::hashPool);
+}
+
+/**
+ * Dispatches a message received while the student flow is active.
+ *
+ * @param request Client request.
+ */
+void Session::onStudentMessage(const string& request) {
+    switch (state) {
+        case SessionState::STUDENT_PENDING_SHEET: {
+            // Exam name of a backed-up answer sheet, or "n" if there is none
+            string examName = request;
+            examName.erase(0, examName.find_first_not_of(" \t\n\r"));
+            examName.erase(examName.find_last_not_of(" \t\n\r") + 1);
+
+            if (examName != "n") {
+                pendingExamName = examName;
+                state = SessionState::STUDENT_PENDING_ANSWERS;
+            } else {
+                state = SessionState::STUDENT_MENU;
+            }
+            break;
+        }
+
+        case SessionState::STUDENT_PENDING_ANSWERS:
+            state = SessionState::STUDENT_MENU;
+            offload([request](Session& s) {
+                Server::receiveStudentAnswers(s, s.pendingExamName, request);
+                s.pendingExamName.clear();
+            });
+            break;
+
+        case SessionState::STUDENT_MENU:
+            if (request == "1") {
+                // Send available exams; wait for a selection only if there are any
+                if (Server::sendStudentExamList(*this))
+                    state = SessionState::STUDENT_EXAM_SELECT;
+                Metrics::observe(Op::EXAM_LIST, requestStart);
+            } else if (request == "2") {
+                offload([](Session& s) {
+                    Server::handleViewPerformance(s);
+                    Metrics::observe(Op::DASHBOARD, s.requestStart);
+                });
+            } else if (request == "3") {
+                SessionTokens::revoke(token);
+                close();
+            }
+            break;
+
+        case SessionState::STUDENT_EXAM_SELECT:
+            // 0 means the student went back to the menu; nothing to reply
+            if (atoi(request.c_str()) == 0) {
+                state = SessionState::STUDENT_MENU;
+                break;
+            }
+            offload([request](Session& s) {
+                Server::handleStudentExamRequest(s, request);
+                Metrics::observe(Op::PAPER, s.requestStart, s.state == SessionState::STUDENT_EXAM_CONFIRM ||
+                                                            s.state == SessionState::STUDENT_EXAM_SEALED);
+            });
+            break;
+
+        case SessionState::STUDENT_EXAM_CONFIRM:
+            if (request == "y" || request == "Y") {
+                state = SessionState::STUDENT_EXAM_TYPE;
+            } else {
+                state = SessionState::STUDENT_MENU;
+            }
+            break;
+
+        case SessionState::STUDENT_EXAM_SEALED:
+            // The exam has not started; whatever the answer, back to the menu
+            state = SessionState::STUDENT_MENU;
+            break;
+
+        case SessionState::STUDENT_EXAM_TYPE:
+            // For scheduled exams, check if the student has already attempted it
+            state = SessionState::STUDENT_ANSWERS;
+            if (request == "s") {
+                // Answered from memory; a second start of the same exam is refused
+                if (!AttemptIndex::claim(username, selectedExamName)) {
+                    reply(MsgType::ACK, "y");
+                    state = SessionState::STUDENT_MENU;
+                } else {
+                    reply(MsgType::ACK, "n");
+                    beginExam();
+                }
+            } else {
+                beginExam();
+            }
+            break;
+
+        case SessionState::STUDENT_ANSWERS:
+            state = SessionState::STUDENT_MENU;
+            // The token keeps the exam until the job runs: a submit refused
+            // as BUSY can still be resumed and autosaved
+            offload([request](Session& s) {
+                Server::receiveStudentAnswers(s, s.selectedExamName, request);
+                SessionTokens::setExam(s.token, "", 0);
+            });
+            break;
+
+        case SessionState::DASHBOARD_EXAM:
+            Server::handleDashboardExam(*this, request);
+            break;
+
+        case SessionState::DASHBOARD_ATTEMPT:
+            offload([request](Session& s) { Server::handleDashboardAttempt(s, request); });
+            break;
+
+        case SessionState::DASHBOARD_LEADERBOARD:
+            if (atoi(request.c_str()) != 1) {
+                Server::sendDashboard(*this);
+                break;
+            }
+            state = SessionState::STUDENT_MENU;
+            offload([](Session& s) {
+                Server::analyzeExam(s.dashboardExam, s, true);
+                Metrics::observe(Op::ANALYSIS, s.requestStart);
+            });
+            break;
+
+        default:
+            break;
+    }
+}
+
+/**
+ * Dispatches a message received while the instructor flow is active.
+ *
+ * @param request Client request.
+ */
+void Session::onInstructorMessage(const string& request) {
+    switch (state) {
+        case SessionState::INSTRUCTOR_MENU:
+            if (request == "1") {
+                state = SessionState::INSTRUCTOR_UPLOAD;
+            } else if (request == "3") {
+                Server::sendAvailableExams(*this, username, examNames);
+                if (!examNames.empty()) state = SessionState::INSTRUCTOR_ANALYSIS_SELECT;
+            } else if (request == "4") {
+                vector<string> all_exams;
+                Server::sendAvailableExams(*this, username, all_exams);
+            } else if (request == "5") {
+                SessionTokens::revoke(token);
+                close();
+            }
+            break;
+
+        case SessionState::INSTRUCTOR_UPLOAD:
+            state = SessionState::INSTRUCTOR_MENU;
+            offload([request](Session& s) { Server::handleUploadExam(s, request); });
+            break;
+
+        case SessionState::INSTRUCTOR_ANALYSIS_SELECT: {
+            int selection = atoi(request.c_str());
+            state = SessionState::INSTRUCTOR_MENU;
+            if (selection <= 0 || selection > (int)examNames.size()) {
+                reply("[!] Invalid exam selection.");
+                break;
+            }
+            offload([selection](Session& s) {
+                Server::analyzeExam(s.examNames[selection - 1], s, false);
+                Metrics::observe(Op::ANALYSIS, s.requestStart);
+            });
+            break;
+        }
+
+        case SessionState::INSTRUCTOR_ANALYSIS_DETAIL:
+            Server::handleAnalysisDetail(*this, request);
+            break;
+
+        default:
+            break;
+    }
+}
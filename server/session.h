@@ -0,0 +1,125 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <functional>
+#include <cstdint>
+#include <chrono>
+#include <memory>
+#include <sys/types.h>
+
+#include "protocol.h"
+#include "attempt_index.h"
+
+using namespace std;
+
+class Reactor;
+class WorkerPool;
+
+// A byte range of an open file, written to the socket with sendfile(); the
+// owner keeps the file open until the range has been sent
+struct FileSlice {
+    shared_ptr<const void> owner;
+    int fd = -1;
+    off_t offset = 0;
+    size_t length = 0;
+};
+
+// A pending piece of output (an encoded frame, a frame shared between
+// connections, or a file range) and how much of it was written
+struct OutChunk {
+    string data;
+    shared_ptr<const string> shared;    // used instead of data when set
+    FileSlice file;                     // used instead of data when file.fd != -1
+    size_t offset = 0;
+
+    const string& bytes() const { return shared ? *shared : data; }
+    size_t size() const { return file.fd != -1 ? file.length : bytes().size(); }
+};
+
+// Where a connection currently is in the student or instructor flow
+enum class SessionState {
+    AUTH,                       // waiting for LOGIN / REGISTER / exit
+    STUDENT_PENDING_SHEET,      // waiting for a backed-up exam name (or "n")
+    STUDENT_PENDING_ANSWERS,    // waiting for the backed-up answer sheet
+    STUDENT_MENU,
+    STUDENT_EXAM_SELECT,        // exam list sent, waiting for exam number
+    STUDENT_EXAM_CONFIRM,       // paper sent, waiting for y/n
+    STUDENT_EXAM_SEALED,        // sealed paper handed out before the start, waiting for "n"
+    STUDENT_EXAM_TYPE,          // waiting for 's' (scheduled) or practice marker
+    STUDENT_ANSWERS,            // exam running, waiting for ANSWERS
+    DASHBOARD_EXAM,             // attempted-exam list sent
+    DASHBOARD_ATTEMPT,          // attempt list sent
+    DASHBOARD_LEADERBOARD,      // attempt details sent, waiting for leaderboard choice
+    INSTRUCTOR_MENU,
+    INSTRUCTOR_UPLOAD,          // waiting for exam details
+    INSTRUCTOR_ANALYSIS_SELECT, // own exams sent, waiting for exam number
+    INSTRUCTOR_ANALYSIS_DETAIL, // leaderboard sent, waiting for student sr no.
+    CLOSED
+};
+
+// Everything analyzeExam needs to answer per-student detail requests later
+struct AnalysisView {
+    string examName;
+    vector<uint64_t> order;     // leaderboard position -> journal LSN of the attempt
+    string leaderboardReport;
+};
+
+// Per-connection protocol state machine for the student and instructor flows.
+// Lives on the reactor thread; while busy, a worker owns it exclusively.
+class Session {
+public:
+    uint64_t id;
+    int fd;
+    SessionState state;
+    string username;
+    string user_type;
+    string token;               // session token for reconnecting, see SessionTokens
+
+    // Student exam flow
+    string pendingExamName;
+    string selectedExamName;
+
+    // Student dashboard flow: exam -> attempts, from the attempt index
+    map<string, vector<AttemptRef>> attempts;
+    vector<string> attemptedExams;
+    string dashboardExam;
+
+    // Instructor analysis flow
+    vector<string> examNames;
+    AnalysisView analysis;
+
+    // When the frame being handled was dispatched, for latency metrics
+    chrono::steady_clock::time_point requestStart;
+
+    // Worker hand-off: encoded replies produced by a job and frames that arrived meanwhile
+    bool busy;
+    vector<OutChunk> deferred;
+    deque<Frame> pending;
+
+    Session(uint64_t id, int fd, Reactor* reactor);
+    void onMessage(const Frame& frame);
+    void reply(const string& data);
+    void reply(MsgType type, const string& data);
+    void sendFile(const FileSlice& slice);
+    void sendShared(shared_ptr<const string> frame);
+    void close();
+    Reactor* owner() const { return reactor; }
+
+private:
+    Reactor* reactor;
+    SessionState requestState;  // state before the current request, restored if it is rejected as busy
+
+    void offload(function<void(Session&)> job, WorkerPool* pool = nullptr);
+
+    void beginExam();
+    void saveAnswers(const string& changes);
+    void onAuth(const string& message);
+    void onStudentMessage(const string& message);
+    void onInstructorMessage(const string& message);
+};
+
+#endif
@@ -0,0 +1,175 @@
+#include "session_tokens.h"
+#include "metrics.h"
+#include "config.h"
+#include "answer_sheet.h"
+
+#define TOKEN_BYTES 16
+
+unordered_map<string, ResumePoint> SessionTokens::points;
+pthread_mutex_t SessionTokens::mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Idle expiry of a token. During an exam it lasts until the deadline plus one
+ * TTL of grace, so the final submit (sent after the student acknowledges the
+ * end) still finds the autosaved draft.
+ */
+time_t SessionTokens::expiryFor(const ResumePoint& point, time_t now) {
+    time_t expires = now + ServerConfig::sessionTtlSeconds;
+    if (!point.examName.empty()) expires = max(expires, point.deadline + ServerConfig::sessionTtlSeconds);
+    return expires;
+}
+
+/**
+ * Creates a token for a user who just logged in or registered.
+ *
+ * @param username Authenticated user.
+ * @param userType "student" or "instructor".
+ * @return Hex token (no whitespace), or an empty string if no random bytes
+ *         were available.
+ */
+string SessionTokens::issue(const string& username, const string& userType) {
+    unsigned char bytes[TOKEN_BYTES];
+    if (RAND_bytes(bytes, TOKEN_BYTES) != 1) {
+        cerr << "Error: Could not generate a session token" << endl;
+        return "";
+    }
+
+    static const char digits[] = "0123456789abcdef";
+    string token;
+    for (unsigned char b : bytes) {
+        token += digits[b >> 4];
+        token += digits[b & 0xf];
+    }
+
+    ResumePoint point{username, userType, "", 0, 0, {}};
+    point.expires = expiryFor(point, time(nullptr));
+
+    Metrics::lock(&mutex, LockId::SESSION_TOKENS);
+    points[token] = point;
+    pthread_mutex_unlock(&mutex);
+    return token;
+}
+
+/**
+ * Looks up a token presented by a reconnecting client and renews it.
+ *
+ * @param token Token from an earlier login.
+ * @param point Receives where the user was.
+ * @return False if the token is unknown or expired.
+ */
+bool SessionTokens::resume(const string& token, ResumePoint& point) {
+    time_t now = time(nullptr);
+    Metrics::lock(&mutex, LockId::SESSION_TOKENS);
+    auto it = points.find(token);
+    bool valid = it != points.end() && it->second.expires > now;
+    if (valid) {
+        it->second.expires = expiryFor(it->second, now);
+        point = it->second;
+    } else if (it != points.end()) {
+        points.erase(it);
+    }
+    pthread_mutex_unlock(&mutex);
+    return valid;
+}
+
+/**
+ * Records that the user started (or, with an empty name, left) an exam.
+ *
+ * @param token Session token; ignored if empty or unknown.
+ * @param examName Exam in progress, or "" when back at the menu.
+ * @param deadline When the exam ends.
+ */
+void SessionTokens::setExam(const string& token, const string& examName, time_t deadline) {
+    if (token.empty()) return;
+
+    Metrics::lock(&mutex, LockId::SESSION_TOKENS);
+    auto it = points.find(token);
+    if (it != points.end()) {
+        it->second.examName = examName;
+        it->second.deadline = deadline;
+        it->second.expires = expiryFor(it->second, time(nullptr));
+        // A new attempt starts with a blank draft; leaving keeps it for the final submit
+        if (!examName.empty()) it->second.draft = AnswerDraft();
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+/**
+ * Applies a batch of autosaved answer changes to the draft of an exam.
+ *
+ * @param token Session token.
+ * @param examName Exam being answered.
+ * @param questions Question count of the exam.
+ * @param changes Batch encoded with AnswerSheet::addChange.
+ * @return False if the token is unknown or the batch is malformed.
+ */
+bool SessionTokens::saveAnswers(const string& token, const string& examName, size_t questions, string_view changes) {
+    if (token.empty()) return false;
+
+    Metrics::lock(&mutex, LockId::SESSION_TOKENS);
+    auto it = points.find(token);
+    bool saved = it != points.end();
+    if (saved) {
+        AnswerDraft& draft = it->second.draft;
+        if (draft.examName != examName || draft.answers.size() != questions) {
+            draft.examName = examName;
+            draft.answers.assign(questions, -1);
+            draft.seconds.assign(questions, 0);
+        }
+        saved = AnswerSheet::applyChanges(changes, questions, draft.answers.data(), draft.seconds.data());
+        // An autosave is activity; it keeps the token alive
+        it->second.expires = expiryFor(it->second, time(nullptr));
+    }
+    pthread_mutex_unlock(&mutex);
+    return saved;
+}
+
+/**
+ * Removes and returns the draft of an exam, for grading.
+ *
+ * @param token Session token.
+ * @param examName Exam being submitted.
+ * @param draft Receives the answers saved so far.
+ * @return False if nothing was saved for this exam.
+ */
+bool SessionTokens::takeAnswers(const string& token, const string& examName, AnswerDraft& draft) {
+    if (token.empty()) return false;
+
+    Metrics::lock(&mutex, LockId::SESSION_TOKENS);
+    auto it = points.find(token);
+    bool found = it != points.end() && it->second.draft.examName == examName;
+    if (found) {
+        draft = move(it->second.draft);
+        it->second.draft = AnswerDraft();
+    }
+    pthread_mutex_unlock(&mutex);
+    return found;
+}
+
+/**
+ * Forgets a token (explicit logout).
+ */
+void SessionTokens::revoke(const string& token) {
+    if (token.empty()) return;
+
+    Metrics::lock(&mutex, LockId::SESSION_TOKENS);
+    points.erase(token);
+    pthread_mutex_unlock(&mutex);
+}
+
+/**
+ * Drops every expired token.
+ *
+ * @return Number of tokens still live.
+ */
+size_t SessionTokens::purgeExpired() {
+    time_t now = time(nullptr);
+    Metrics::lock(&mutex, LockId::SESSION_TOKENS);
+    for (auto it = points.begin(); it != points.end();) {
+        if (it->second.expires <= now) it = points.erase(it);
+        else ++it;
+    }
+    size_t live = points.size();
+    pthread_mutex_unlock(&mutex);
+    return live;
+}
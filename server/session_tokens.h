@@ -0,0 +1,56 @@
+#ifndef SESSION_TOKENS_H
+#define SESSION_TOKENS_H
+
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include <string_view>
+#include <cstdint>
+#include <ctime>
+#include <pthread.h>
+#include <openssl/rand.h>
+
+using namespace std;
+
+// Answers autosaved during an exam, in paper order
+struct AnswerDraft {
+    string examName;
+    vector<int8_t> answers;     // -1 if not answered
+    vector<uint32_t> seconds;
+};
+
+// Where a logged-in user was, kept so a dropped client can come back
+struct ResumePoint {
+    string username;
+    string userType;
+    string examName;        // exam in progress, empty when at the menu
+    time_t deadline;        // end of the exam in progress
+    time_t expires;         // the token is forgotten after this
+    AnswerDraft draft;      // answers of the last exam, until it is submitted
+};
+
+// Session tokens issued at login. A client that loses its connection sends
+// "RESUME <token>" on a new one and is put back where it was, without the
+// password KDF and, in an exam, with the time it has left. Tokens live for
+// session_ttl_seconds after their last use, or until the exam they are in
+// ends if that is later.
+class SessionTokens {
+public:
+    static string issue(const string& username, const string& userType);
+    static bool resume(const string& token, ResumePoint& point);
+    static void setExam(const string& token, const string& examName, time_t deadline);
+    static bool saveAnswers(const string& token, const string& examName, size_t questions, string_view changes);
+    static bool takeAnswers(const string& token, const string& examName, AnswerDraft& draft);
+    static void revoke(const string& token);
+    static size_t purgeExpired();
+
+private:
+    static unordered_map<string, ResumePoint> points;
+    static pthread_mutex_t mutex;
+
+    static time_t expiryFor(const ResumePoint& point, time_t now);
+};
+
+#endif
@@ -0,0 +1,342 @@
+#include "submission.h"
+
+#define RECORD_VERSION 1
+
+const int positiveMark = 4, negativeMark = -1;
+
+/**
+ * Marks awarded for one question: +4 correct, -1 wrong, 0 skipped.
+ */
+int Submission::marks(size_t q) const {
+    if (answers[q] == -1) return 0;
+    return answers[q] == correct[q] ? positiveMark : negativeMark;
+}
+
+int Submission::totalMarks() const {
+    int total = 0;
+    for (size_t q = 0; q < answers.size(); ++q) total += marks(q);
+    return total;
+}
+
+int Submission::attempted() const {
+    int count = 0;
+    for (int8_t a : answers) if (a != -1) count++;
+    return count;
+}
+
+int Submission::wrong() const {
+    int count = 0;
+    for (size_t q = 0; q < answers.size(); ++q) if (marks(q) < 0) count++;
+    return count;
+}
+
+uint32_t Submission::totalTime() const {
+    uint32_t total = 0;
+    for (uint32_t t : times) total += t;
+    return total;
+}
+
+static void putU16(string& out, uint16_t v) {
+    out.push_back(static_cast<char>(v & 0xFF));
+    out.push_back(static_cast<char>(v >> 8));
+}
+
+static void putU32(string& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+}
+
+static void putString(string& out, const string& s) {
+    putU16(out, s.size());
+    out += s;
+}
+
+/**
+ * Serializes the submission into a journal record:
+ * version, student id, exam name, timestamp (u16 length + bytes each),
+ * question count (u16), then per question answer (i8), key (i8), time (u32).
+ */
+string Submission::encode() const {
+    string out;
+    out.push_back(RECORD_VERSION);
+    putString(out, studentId);
+    putString(out, examName);
+    putString(out, timestamp);
+    putU16(out, answers.size());
+    for (size_t q = 0; q < answers.size(); ++q) {
+        out.push_back(static_cast<char>(answers[q]));
+        out.push_back(static_cast<char>(correct[q]));
+        putU32(out, times[q]);
+    }
+    return out;
+}
+
+/**
+ * Parses a journal record produced by encode().
+ *
+ * @param payload Record bytes.
+ * @param out Receives the submission.
+ * @return False if the record is malformed or of an unknown version.
+ */
+bool Submission::decode(const string& payload, Submission& out) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(payload.data());
+    size_t pos = 0, size = payload.size();
+
+    auto u16 = [&](uint16_t& v) {
+        if (pos + 2 > size) return false;
+        v = uint16_t(p[pos]) | (uint16_t(p[pos + 1]) << 8);
+        pos += 2;
+        return true;
+    };
+    auto str = [&](string& s) {
+        uint16_t len;
+        if (!u16(len) || pos + len > size) return false;
+        s.assign(payload, pos, len);
+        pos += len;
+        return true;
+    };
+
+    if (size < 1 || p[0] != RECORD_VERSION) return false;
+    pos = 1;
+
+    uint16_t count;
+    if (!str(out.studentId) || !str(out.examName) || !str(out.timestamp) || !u16(count)) return false;
+    if (pos + size_t(count) * 6 != size) return false;
+
+    out.answers.resize(count);
+    out.correct.resize(count);
+    out.times.resize(count);
+    for (uint16_t q = 0; q < count; ++q) {
+        out.answers[q] = static_cast<int8_t>(p[pos]);
+        out.correct[q] = static_cast<int8_t>(p[pos + 1]);
+        out.times[q] = uint32_t(p[pos + 2]) | (uint32_t(p[pos + 3]) << 8) |
+                       (uint32_t(p[pos + 4]) << 16) | (uint32_t(p[pos + 5]) << 24);
+        pos += 6;
+    }
+    return true;
+}
+
+string ResultViews::attemptsPath(const string& studentId) {
+    return "../data/results/student_" + studentId + "_attempts.txt";
+}
+
+string ResultViews::performancePath(const string& studentId, const string& examName) {
+    return "../data/results/student_" + studentId + "_" + examName + "_performance.txt";
+}
+
+string ResultViews::analysisPath(const string& examName) {
+    return "../data/results/exam_" + examName + "_analysis.txt";
+}
+
+string ResultViews::examLogPath() {
+    return "../data/results/exam_log.txt";
+}
+
+/**
+ * Appends text to a file with a single O_APPEND write, so concurrent
+ * appenders never interleave within it.
+ */
+static void appendFile(const string& path, const string& text) {
+    int fd = open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (fd == -1 || write(fd, text.data(), text.size()) != (ssize_t)text.size())
+        cerr << "Error: Unable to write " << path << endl;
+    if (fd != -1) close(fd);
+}
+
+/**
+ * Appends a committed batch to the result files. Text for the same file is
+ * gathered first, so each file is opened once per batch however many
+ * students submitted.
+ *
+ * @param batch Submissions in journal order.
+ */
+void ResultViews::apply(const vector<Submission>& batch) {
+    map<string, string> performanceFiles;
+    map<string, string> attemptFiles;
+    map<string, string> analysisFiles;
+    string examLog;
+
+    for (const Submission& s : batch) {
+        int totalQuestions = s.answers.size();
+        string perfPath = performancePath(s.studentId, s.examName);
+
+        // Basic metadata about this attempt
+        attemptFiles[attemptsPath(s.studentId)] += s.examName + "|" + s.timestamp + "|" +
+            to_string(s.totalMarks()) + "|" + to_string(totalQuestions * 4) + "|" + perfPath + "\n";
+
+        // Detailed performance info followed by per-question details
+        string& perf = performanceFiles[perfPath];
+        perf += "START\n" + s.timestamp + "|" + s.examName + "|" + to_string(s.totalMarks()) + "|" +
+                to_string(totalQuestions * 4) + "|" + to_string(totalQuestions) + "|" +
+                to_string(s.attempted()) + "|" + to_string(s.wrong()) + "|" + to_string(s.totalTime()) + "\nEND\n";
+        for (int i = 0; i < totalQuestions; ++i) {
+            perf += "Q" + to_string(i + 1) + "|" + to_string(s.marks(i)) + "|";
+            perf += (s.answers[i] != -1) ? string(1, static_cast<char>('A' + s.answers[i])) + "|" : "NA|";
+            perf += to_string(s.times[i]) + "s\n";
+        }
+
+        examLog += s.studentId + ": " + s.examName + ": " + s.timestamp + "\n";
+
+        // The analysis file starts with the answer key the first time an exam is seen
+        string analysisPathName = analysisPath(s.examName);
+        auto it = analysisFiles.find(analysisPathName);
+        if (it == analysisFiles.end()) {
+            it = analysisFiles.emplace(analysisPathName, "").first;
+            if (access(analysisPathName.c_str(), F_OK) != 0) {
+                for (int8_t key : s.correct) it->second += string(1, static_cast<char>('A' + key)) + " ";
+                it->second += "\n";
+            }
+        }
+        it->second += s.studentId;
+        for (int i = 0; i < totalQuestions; ++i) {
+            if (s.answers[i] == -1) it->second += " - " + to_string(s.times[i]);
+            else it->second += " " + string(1, static_cast<char>('A' + s.answers[i])) + " " + to_string(s.times[i]);
+        }
+        it->second += "\n";
+    }
+
+    // The result writer is the only writer, and the server answers from
+    // memory instead of reading these files back, so appends need no lock
+    for (const auto& [path, text] : performanceFiles) appendFile(path, text);
+    for (const auto& [path, text] : attemptFiles) appendFile(path, text);
+    appendFile(examLogPath(), examLog);
+    for (const auto& [path, text] : analysisFiles) appendFile(path, text);
+}
+
+/**
+ * Regenerates every result file covered by the journal: the files are
+ * removed and rewritten from the full list of submissions.
+ *
+ * @param all Every submission in the journal, in order.
+ */
+void ResultViews::rebuild(const vector<Submission>& all) {
+    if (all.empty()) return;
+
+    set<string> paths = {examLogPath()};
+    for (const Submission& s : all) {
+        paths.insert(attemptsPath(s.studentId));
+        paths.insert(performancePath(s.studentId, s.examName));
+        paths.insert(analysisPath(s.examName));
+    }
+    for (const string& path : paths) unlink(path.c_str());
+
+    apply(all);
+    cout << "[+] result files rebuilt from " << all.size() << " journaled submissions" << endl;
+}
+
+/**
+ * Reads the answer key line of a legacy analysis file ("A C B ...").
+ */
+static vector<int8_t> legacyKey(const string& examName) {
+    vector<int8_t> key;
+    ifstream in(ResultViews::analysisPath(examName));
+    string line, letter;
+    if (!getline(in, line)) return key;
+    istringstream letters(line);
+    while (letters >> letter) {
+        if (letter.size() != 1 || letter[0] < 'A' || letter[0] > 'D') return {};
+        key.push_back(letter[0] - 'A');
+    }
+    return key;
+}
+
+/**
+ * Parses the START/END blocks of one legacy performance file.
+ *
+ * @param path Performance file.
+ * @param studentId Student the file belongs to.
+ * @param out Receives one submission per attempt in the file.
+ */
+static void readLegacyPerformance(const string& path, const string& studentId, vector<Submission>& out) {
+    ifstream in(path);
+    string line;
+    getline(in, line);
+    while (in && line == "START") {
+        // "timestamp|exam|marks|total|questions|attempted|wrong|time", then END
+        string summary, end;
+        getline(in, summary);
+        getline(in, end);
+        Submission s;
+        s.studentId = studentId;
+        istringstream fields(summary);
+        getline(fields, s.timestamp, '|');
+        getline(fields, s.examName, '|');
+        bool valid = end == "END" && !s.timestamp.empty() && !s.examName.empty();
+
+        // "Q<n>|<marks>|<A-D or NA>|<seconds>s" per question
+        vector<int> marks;
+        while (getline(in, line) && line != "START") {
+            istringstream q(line);
+            string number, mark, option, seconds;
+            getline(q, number, '|');
+            getline(q, mark, '|');
+            getline(q, option, '|');
+            getline(q, seconds, 's');
+            if (option != "NA" && (option.size() != 1 || option[0] < 'A' || option[0] > 'D')) valid = false;
+            if (!valid) continue;
+            marks.push_back(atoi(mark.c_str()));
+            s.answers.push_back(option == "NA" ? -1 : option[0] - 'A');
+            s.times.push_back(strtoul(seconds.c_str(), nullptr, 10));
+        }
+        if (!valid || s.answers.empty()) {
+            cerr << "Warning: skipping unreadable attempt in " << path << endl;
+            continue;
+        }
+
+        // The key from the analysis file, adjusted so the recorded marks come out the same
+        vector<int8_t> key = legacyKey(s.examName);
+        s.correct.assign(s.answers.size(), 0);
+        for (size_t q = 0; q < s.answers.size(); ++q) {
+            if (q < key.size()) s.correct[q] = key[q];
+            if (s.answers[q] == -1) continue;
+            if (marks[q] > 0) s.correct[q] = s.answers[q];
+            else if (marks[q] < 0 && s.correct[q] == s.answers[q]) s.correct[q] = (s.answers[q] + 1) % 4;
+        }
+        out.push_back(move(s));
+    }
+}
+
+/**
+ * Recovers every attempt from result files written before the journal: each
+ * student_<id>_attempts.txt names the student, and the performance files it
+ * lists hold the answers and times of every attempt.
+ *
+ * @return Legacy attempts, oldest first.
+ */
+vector<Submission> ResultViews::readLegacy() {
+    vector<Submission> all;
+    const string prefix = "student_", suffix = "_attempts.txt";
+    DIR* dir = opendir("../data/results");
+    if (!dir) return all;
+
+    string line;
+    while (dirent* entry = readdir(dir)) {
+        string name = entry->d_name;
+        if (name.size() <= prefix.size() + suffix.size() || name.compare(0, prefix.size(), prefix) != 0 ||
+            name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) continue;
+        string studentId = name.substr(prefix.size(), name.size() - prefix.size() - suffix.size());
+
+        // "exam|timestamp|marks|total|performance file" per attempt
+        set<string> perfPaths;
+        ifstream attempts(attemptsPath(studentId));
+        while (getline(attempts, line)) {
+            size_t pos = line.rfind('|');
+            if (pos != string::npos) perfPaths.insert(line.substr(pos + 1));
+        }
+        for (const string& path : perfPaths) readLegacyPerformance(path, studentId, all);
+    }
+    closedir(dir);
+
+    // Oldest first; within a second, in the order of the exam log
+    map<string, size_t> logged;
+    ifstream log(examLogPath());
+    for (size_t n = 0; getline(log, line); ++n) logged.emplace(line, n);
+    auto position = [&logged](const Submission& s) {
+        auto it = logged.find(s.studentId + ": " + s.examName + ": " + s.timestamp);
+        return it == logged.end() ? SIZE_MAX : it->second;
+    };
+    stable_sort(all.begin(), all.end(), [&position](const Submission& a, const Submission& b) {
+        if (a.timestamp != b.timestamp) return a.timestamp < b.timestamp;
+        return position(a) < position(b);
+    });
+    return all;
+}
@@ -0,0 +1,56 @@
+#ifndef SUBMISSION_H
+#define SUBMISSION_H
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <cstdint>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sstream>
+#include <algorithm>
+
+using namespace std;
+
+// One graded answer sheet, as stored in the submission journal
+struct Submission {
+    string studentId;
+    string examName;
+    string timestamp;               // "YYYY-MM-DD HH:MM:SS"
+    vector<int8_t> answers;         // chosen option per question (0 = A), -1 if skipped
+    vector<int8_t> correct;         // answer key at the time of submission
+    vector<uint32_t> times;         // seconds spent per question
+
+    int marks(size_t q) const;
+    int totalMarks() const;
+    int attempted() const;
+    int wrong() const;
+    uint32_t totalTime() const;
+
+    string encode() const;
+    static bool decode(const string& payload, Submission& out);
+};
+
+// The text result files (attempt lists, performance files, exam log and
+// analysis files) are views derived from the journal. apply() appends a
+// committed batch to them; rebuild() regenerates them from scratch.
+// readLegacy() recovers the attempts written before the journal existed, so
+// they can be imported into it before the first rebuild.
+class ResultViews {
+public:
+    static void apply(const vector<Submission>& batch);
+    static void rebuild(const vector<Submission>& all);
+    static vector<Submission> readLegacy();
+
+    static string attemptsPath(const string& studentId);
+    static string performancePath(const string& studentId, const string& examName);
+    static string analysisPath(const string& examName);
+    static string examLogPath();
+};
+
+#endif
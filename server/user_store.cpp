@@ -0,0 +1,169 @@
+#include "user_store.h"
+#include "metrics.h"
+
+UserStore::UserStore() : appendFd(-1) {
+    for (Shard& shard : shards) pthread_rwlock_init(&shard.lock, nullptr);
+}
+
+UserStore::~UserStore() {
+    if (appendFd != -1) close(appendFd);
+    for (Shard& shard : shards) pthread_rwlock_destroy(&shard.lock);
+}
+
+UserStore::Shard& UserStore::shardFor(const string& username) {
+    return shards[hash<string>()(username) % SHARDS];
+}
+
+const UserStore::Shard& UserStore::shardFor(const string& username) const {
+    return shards[hash<string>()(username) % SHARDS];
+}
+
+/**
+ * Loads every "username hash" line of a user file and keeps the file open for
+ * appending registrations. The file is memory-mapped and scanned in place, so
+ * its size is only bounded by memory. A missing file is created empty.
+ *
+ * @param path Path to the user file.
+ * @return False if the file could neither be read nor created.
+ */
+bool UserStore::load(const string& path) {
+    filename = path;
+    if (appendFd != -1) close(appendFd);
+    appendFd = open(filename.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (appendFd == -1) {
+        cerr << "Error: Unable to open file " << filename << endl;
+        return false;
+    }
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd == -1 || fstat(fd, &st) == -1) {
+        cerr << "Error: Unable to read " << filename << endl;
+        if (fd != -1) close(fd);
+        return false;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return true;
+    }
+
+    void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        cerr << "Error: Unable to map " << filename << endl;
+        return false;
+    }
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+    // One "username hash" pair per line; blank or malformed lines are skipped
+    const char* p = static_cast<const char*>(map);
+    const char* end = p + st.st_size;
+    while (p < end) {
+        const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+        if (!eol) eol = end;
+
+        const char* name = p;
+        while (name < eol && (*name == ' ' || *name == '\t')) ++name;
+        const char* nameEnd = name;
+        while (nameEnd < eol && *nameEnd != ' ' && *nameEnd != '\t' && *nameEnd != '\r') ++nameEnd;
+        const char* pass = nameEnd;
+        while (pass < eol && (*pass == ' ' || *pass == '\t')) ++pass;
+        const char* passEnd = pass;
+        while (passEnd < eol && *passEnd != ' ' && *passEnd != '\t' && *passEnd != '\r') ++passEnd;
+
+        if (nameEnd > name && passEnd > pass) {
+            string username(name, nameEnd - name);
+            shardFor(username).users[username] = string(pass, passEnd - pass);
+        }
+        p = eol + 1;
+    }
+
+    // Registrations must start on a line of their own
+    bool newline = static_cast<const char*>(map)[st.st_size - 1] == '\n';
+    munmap(map, st.st_size);
+    if (!newline && write(appendFd, "\n", 1) != 1) {
+        cerr << "Error: Unable to write to " << filename << endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Looks up the stored password hash of a user.
+ *
+ * @param username User to look up.
+ * @param hash Receives the stored hash.
+ * @return False if there is no such user.
+ */
+bool UserStore::lookup(const string& username, string& hash) const {
+    const Shard& shard = shardFor(username);
+    Metrics::lockRead(&shard.lock, LockId::USER_STORE);
+    auto it = shard.users.find(username);
+    bool found = it != shard.users.end();
+    if (found) hash = it->second;
+    pthread_rwlock_unlock(&shard.lock);
+    return found;
+}
+
+/**
+ * Adds a user and appends it to the user file. Only the user's shard is
+ * locked; the file append is a single O_APPEND write, so concurrent
+ * registrations never interleave lines.
+ *
+ * @param username New username (no whitespace).
+ * @param hash Password hash to store.
+ * @return False if the user already exists or could not be saved.
+ */
+bool UserStore::insert(const string& username, const string& hash) {
+    if (username.empty() || hash.empty()) return false;
+
+    Shard& shard = shardFor(username);
+    Metrics::lockWrite(&shard.lock, LockId::USER_STORE);
+    bool added = shard.users.emplace(username, hash).second;
+    if (added) {
+        string entry = username + " " + hash + "\n";
+        if (write(appendFd, entry.c_str(), entry.length()) != (ssize_t)entry.length()) {
+            cerr << "Error: Unable to save user to " << filename << endl;
+            shard.users.erase(username);
+            added = false;
+        }
+    }
+    pthread_rwlock_unlock(&shard.lock);
+    return added;
+}
+
+/**
+ * Replaces the password hash of an existing user. The new line is appended;
+ * when the file is loaded the last line of a user wins.
+ *
+ * @param username Existing user.
+ * @param hash New password hash.
+ * @return False if the user does not exist or could not be saved.
+ */
+bool UserStore::update(const string& username, const string& hash) {
+    Shard& shard = shardFor(username);
+    Metrics::lockWrite(&shard.lock, LockId::USER_STORE);
+    auto it = shard.users.find(username);
+    bool updated = it != shard.users.end() && !hash.empty();
+    if (updated) {
+        string entry = username + " " + hash + "\n";
+        updated = write(appendFd, entry.c_str(), entry.length()) == (ssize_t)entry.length();
+        if (updated) it->second = hash;
+        else cerr << "Error: Unable to save user to " << filename << endl;
+    }
+    pthread_rwlock_unlock(&shard.lock);
+    return updated;
+}
+
+/**
+ * Number of users in the table.
+ */
+size_t UserStore::size() const {
+    size_t total = 0;
+    for (const Shard& shard : shards) {
+        Metrics::lockRead(&shard.lock, LockId::USER_STORE);
+        total += shard.users.size();
+        pthread_rwlock_unlock(&shard.lock);
+    }
+    return total;
+}
@@ -0,0 +1,48 @@
+#ifndef USER_STORE_H
+#define USER_STORE_H
+
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <functional>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+// Username -> password hash table of one user type, backed by an append-only
+// "username hash" file. The table is split into shards, each behind its own
+// reader-writer lock, so logins only share a read lock with the few requests
+// that hash to the same shard and a registration blocks a single shard.
+class UserStore {
+public:
+    UserStore();
+    ~UserStore();
+
+    bool load(const string& filename);
+    bool lookup(const string& username, string& hash) const;
+    bool insert(const string& username, const string& hash);
+    bool update(const string& username, const string& hash);
+    size_t size() const;
+
+private:
+    static const int SHARDS = 64;
+
+    struct Shard {
+        mutable pthread_rwlock_t lock;
+        unordered_map<string, string> users;
+    };
+
+    Shard shards[SHARDS];
+    string filename;
+    int appendFd;
+
+    Shard& shardFor(const string& username);
+    const Shard& shardFor(const string& username) const;
+};
+
+#endif
@@ -0,0 +1,141 @@
+#include "worker_pool.h"
+
+/**
+ * Starts the worker threads.
+ *
+ * @param name Pool name used in log lines.
+ * @param threads Number of workers; 0 means one per online core.
+ * @param capacity Maximum number of queued (not yet running) tasks.
+ * @param policy Behaviour of submit() when the queue is full.
+ */
+WorkerPool::WorkerPool(const string& name, int threads, size_t capacity, OverloadPolicy policy)
+    : name(name), capacity(capacity > 0 ? capacity : 1), policy(policy), stopping(false),
+      active(0), submitted(0), completed(0), rejected(0), totalWaitUs(0), maxWaitUs(0) {
+    pthread_mutex_init(&mutex, nullptr);
+    pthread_cond_init(&notEmpty, nullptr);
+    pthread_cond_init(&notFull, nullptr);
+
+    if (threads <= 0) threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads <= 0) threads = 1;
+
+    for (int i = 0; i < threads; ++i) {
+        pthread_t thread;
+        if (pthread_create(&thread, nullptr, workerMain, this) != 0) {
+            cerr << "Error: Could not start " << name << " worker thread\n";
+            continue;
+        }
+        workers.push_back(thread);
+    }
+    cout << "[+] " << name << " pool started with " << workers.size() << " workers" << endl;
+}
+
+/**
+ * Lets the workers finish queued tasks, then joins them.
+ */
+WorkerPool::~WorkerPool() {
+    pthread_mutex_lock(&mutex);
+    stopping = true;
+    pthread_cond_broadcast(&notEmpty);
+    pthread_cond_broadcast(&notFull);
+    pthread_mutex_unlock(&mutex);
+
+    for (pthread_t thread : workers) pthread_join(thread, nullptr);
+
+    pthread_cond_destroy(&notFull);
+    pthread_cond_destroy(&notEmpty);
+    pthread_mutex_destroy(&mutex);
+}
+
+/**
+ * Maps a config value to an overload policy ("queue", "shed", "busy").
+ *
+ * @param text Policy name.
+ * @return The policy; unknown names fall back to QUEUE.
+ */
+OverloadPolicy WorkerPool::parsePolicy(const string& text) {
+    if (text == "shed") return OverloadPolicy::SHED;
+    if (text == "busy") return OverloadPolicy::BUSY;
+    if (text != "queue") cerr << "Warning: unknown overload policy '" << text << "', using queue" << endl;
+    return OverloadPolicy::QUEUE;
+}
+
+/**
+ * Enqueues a task. With the QUEUE policy a full queue blocks the caller
+ * (or, without block, turns the task away uncounted so the caller can retry);
+ * with SHED or BUSY the task is rejected instead.
+ *
+ * @param task Work to run on a worker thread.
+ * @param block Whether a QUEUE pool may wait for a slot.
+ * @return True if the task was accepted, false if it was rejected.
+ */
+bool WorkerPool::submit(function<void()> task, bool block) {
+    pthread_mutex_lock(&mutex);
+
+    while (tasks.size() >= capacity && !stopping) {
+        if (policy != OverloadPolicy::QUEUE || !block) {
+            if (policy != OverloadPolicy::QUEUE) rejected++;
+            pthread_mutex_unlock(&mutex);
+            return false;
+        }
+        pthread_cond_wait(&notFull, &mutex);
+    }
+    if (stopping) {
+        rejected++;
+        pthread_mutex_unlock(&mutex);
+        return false;
+    }
+
+    tasks.push_back({move(task), chrono::steady_clock::now()});
+    submitted++;
+    pthread_cond_signal(&notEmpty);
+    pthread_mutex_unlock(&mutex);
+    return true;
+}
+
+/**
+ * Returns a consistent snapshot of the pool counters.
+ */
+PoolStats WorkerPool::stats() {
+    pthread_mutex_lock(&mutex);
+    PoolStats s{tasks.size(), active, (int)workers.size(), submitted, completed,
+                rejected, totalWaitUs, maxWaitUs};
+    pthread_mutex_unlock(&mutex);
+    return s;
+}
+
+void* WorkerPool::workerMain(void* arg) {
+    static_cast<WorkerPool*>(arg)->runWorker();
+    return nullptr;
+}
+
+/**
+ * Worker loop: take the oldest task, record how long it waited, run it.
+ */
+void WorkerPool::runWorker() {
+    while (true) {
+        pthread_mutex_lock(&mutex);
+        while (tasks.empty() && !stopping) pthread_cond_wait(&notEmpty, &mutex);
+        if (tasks.empty() && stopping) {
+            pthread_mutex_unlock(&mutex);
+            return;
+        }
+
+        Task task = move(tasks.front());
+        tasks.pop_front();
+        uint64_t waitUs = chrono::duration_cast<chrono::microseconds>(
+            chrono::steady_clock::now() - task.enqueued).count();
+        totalWaitUs += waitUs;
+        if (waitUs > maxWaitUs) maxWaitUs = waitUs;
+        waitTimes.record(waitUs);
+        active++;
+        pthread_cond_signal(&notFull);
+        pthread_mutex_unlock(&mutex);
+
+        task.fn();
+
+        pthread_mutex_lock(&mutex);
+        active--;
+        completed++;
+        pthread_mutex_unlock(&mutex);
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <iostream>
+#include <string>
+#include <deque>
+#include <vector>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "metrics.h"
+
+using namespace std;
+
+// What submit() does when the queue is full
+enum class OverloadPolicy {
+    QUEUE,  // wait for a slot (blocking submit, or the reactor parks the job)
+    SHED,   // reject the task; the caller drops the request
+    BUSY    // reject the task; the caller replies "busy, retry in N ms"
+};
+
+// Snapshot of pool counters
+struct PoolStats {
+    size_t queued;              // tasks waiting for a worker
+    int active;                 // workers currently running a task
+    int threads;
+    uint64_t submitted;
+    uint64_t completed;
+    uint64_t rejected;
+    uint64_t totalWaitUs;       // sum of queue wait over started tasks
+    uint64_t maxWaitUs;
+};
+
+// Fixed-size pool of worker threads fed by a bounded FIFO queue
+class WorkerPool {
+public:
+    WorkerPool(const string& name, int threads, size_t capacity, OverloadPolicy policy);
+    ~WorkerPool();
+
+    bool submit(function<void()> task, bool block = true);
+    PoolStats stats();
+    OverloadPolicy getPolicy() const { return policy; }
+    const string& getName() const { return name; }
+    const LatencyHistogram& waitHistogram() const { return waitTimes; }
+
+    static OverloadPolicy parsePolicy(const string& text);
+
+private:
+    struct Task {
+        function<void()> fn;
+        chrono::steady_clock::time_point enqueued;
+    };
+
+    string name;
+    size_t capacity;
+    OverloadPolicy policy;
+    vector<pthread_t> workers;
+    deque<Task> tasks;
+    bool stopping;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+
+    int active;
+    uint64_t submitted, completed, rejected;
+    uint64_t totalWaitUs, maxWaitUs;
+    LatencyHistogram waitTimes;         // queue wait of every started task
+
+    static void* workerMain(void* arg);
+    void runWorker();
+};
+
+#endif